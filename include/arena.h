@@ -0,0 +1,51 @@
+///////////////////////////////////////
+// ARENA ALLOCATOR
+//
+// Bump allocator for memory that is released all at once. An arena hands
+// out aligned pieces of large blocks it takes from `tmalloc`; nothing is
+// freed piece by piece. `arenaReset` releases everything at once and
+// keeps a single block as large as the most the arena ever held, so an
+// arena reset every round (say, every Girvan-Newman iteration) reaches
+// the heap only while it is still growing. Every graph has one arena for
+// what lives as long as the graph and one for the scratch of a single
+// iteration (see SparseUGraph).
+
+#define ARENA_BLOCK_SIZE    (1 << 20)   // default bytes per block
+#define ARENA_ALIGN         16          // alignment of every piece
+
+typedef struct ArenaBlock {
+
+    struct ArenaBlock *next;    // the block filled before this one
+    size_t size;                // bytes of data after the header
+    size_t used;
+
+} ArenaBlock;
+
+typedef struct {
+
+    ArenaBlock *head;       // block being filled; NULL if none yet
+    size_t block_size;      // smallest block to take from the heap
+    size_t used;            // bytes handed out since the last reset
+    size_t peak;            // most bytes handed out between resets
+
+    // statistics, see `printAllocStats`
+    uint64_t allocs;        // pieces handed out
+    uint64_t resets;
+    uint64_t blocks;        // blocks taken from the heap
+
+} Arena;
+
+// start an empty arena taking blocks of at least `block_size` bytes
+void newArena(Arena *a, size_t block_size);
+
+// return `size` uninitialized bytes that live until the next reset
+void *arenaAlloc(Arena *a, size_t size);
+
+// like `arenaAlloc`, for `nitems` zeroed items of `size` bytes
+void *arenaCalloc(Arena *a, size_t nitems, size_t size);
+
+// release everything handed out so far
+void arenaReset(Arena *a);
+
+// release everything and the blocks too
+void freeArena(Arena *a);
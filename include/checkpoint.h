@@ -0,0 +1,84 @@
+///////////////////////////////////////
+// GIRVAN-NEWMAN CHECKPOINTS
+//
+// The state of a Girvan-Newman run is the edges cut so far, which only
+// live in the graph, the betweenness accumulated over all iterations and
+// the `node_id` order the samples are drawn from, which every iteration
+// re-sorts. With checkpointing on, `girvanNewman` logs every cut with its
+// iteration and, at most once per interval, writes the log, the
+// betweenness, the sampling order and the loop counters to a checkpoint
+// file. A resumed run reads the same graph (edge list or snapshot) with
+// the same options, reapplies the cuts in order, replaying the dendrogram
+// if one is attached, and carries on from the next iteration; since it
+// starts from the same state, it finishes exactly like an uninterrupted
+// run.
+//
+// The file is a header followed by the cut log, the betweenness and the
+// sampling order, each on a SNAPSHOT_ALIGN boundary. It is written to a
+// temporary file that is renamed over the previous checkpoint, so a run
+// killed while writing leaves the previous one intact.
+
+#define CHECKPOINT_MAGIC    "cdgnc\r\n"   // 8 bytes including the NUL
+#define CHECKPOINT_VERSION  1
+#define CHECKPOINT_INTERVAL 300     // default seconds between checkpoints
+
+// array sections, in file order
+#define CKPT_CUTS           0
+#define CKPT_EDGE_BET       1
+#define CKPT_NODE_ID        2
+#define CKPT_NUM_SECTIONS   3
+
+// one logged cut; the log is in order of iteration
+typedef struct {
+
+    node_t src;
+    node_t dest;
+    node_t iteration;
+
+} CutRecord;
+
+typedef struct {
+
+    char magic[8];
+    uint32_t version;
+    uint16_t node_bytes;    // size of a node id
+    uint16_t unused;
+    int64_t n;              // number of nodes
+    int64_t m;              // number of edges before any cut
+    uint64_t fingerprint;   // of the node ids and degrees, in node order
+    int64_t num_clusters;   // k asked for
+    double sample_rate;
+    int64_t iteration;      // next iteration to run
+    int64_t edges_cut;
+    int64_t label_at;       // edges cut at which communities are next counted
+    int64_t num_cuts;       // records in the cut log
+    int64_t num_bet;        // betweenness values: m, or 0 if none yet
+    int64_t offset[CKPT_NUM_SECTIONS];  // byte offset of each array
+
+} CheckpointHeader;
+
+// checkpointing state of a run
+typedef struct {
+
+    char *path;             // file the checkpoints are written to
+    double interval;        // seconds between checkpoints
+    double last;            // when the last one was written, or the run started
+    uint64_t fingerprint;   // of the graph being cut
+    Vector cuts;            // (src, dest, iteration) of every edge cut so far
+
+    // where the loop stands, as of the last checkpoint written or read
+    node_t num_clusters;
+    double sample_rate;
+    int iteration;          // next iteration to run; 1 if not resumed
+    edge_t edges_cut;
+    edge_t label_at;
+
+} Checkpoint;
+
+// log the (src, dest) pairs in `cut` as cut by `iteration`
+void logCuts(Checkpoint *c, Vector *cut, int iteration);
+
+// return 1 if the interval since the last checkpoint has passed
+int checkpointDue(Checkpoint *c);
+
+void freeCheckpoint(Checkpoint *c);
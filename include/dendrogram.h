@@ -0,0 +1,100 @@
+///////////////////////////////////////
+// GIRVAN-NEWMAN DENDROGRAM
+//
+// Every cut only ever splits a community, so one run traces a whole
+// divisive hierarchy. With a dendrogram attached, `girvanNewman` finds
+// the connected components after every iteration and records each split
+// as new clusters whose parent is the cluster they split from. Clusters
+// are numbered in the order they appear, so a parent always has a smaller
+// number than its children. A level is recorded for the starting
+// components and for every iteration that split something, with the
+// number of clusters then, the edges cut so far and the modularity of the
+// partition in the original graph.
+//
+// The dendrogram file is a header followed by these arrays, each on a
+// SNAPSHOT_ALIGN boundary: the original id and final (leaf) cluster of
+// every node, the parent and level of birth of every cluster, and the
+// levels. A partition at any level comes out of it in O(n): sweep the
+// clusters in order, letting each stand for itself if it was born by
+// then, or else for whatever its parent stands for.
+
+#define DENDRO_MAGIC        "cddnd\r\n"   // 8 bytes including the NUL
+#define DENDRO_VERSION      1
+
+// array sections, in file order
+#define DENDRO_ID           0
+#define DENDRO_LEAF         1
+#define DENDRO_PARENT       2
+#define DENDRO_BIRTH        3
+#define DENDRO_LEVELS       4
+#define DENDRO_NUM_SECTIONS 5
+
+// the partition after one iteration that split something
+typedef struct {
+
+    int64_t iteration;      // 0 for the components before any cut
+    int64_t num_clusters;
+    int64_t edges_cut;      // edges cut by the end of the iteration
+    double modularity;
+
+} DendroLevel;
+
+typedef struct {
+
+    char magic[8];
+    uint32_t version;
+    uint16_t node_bytes;    // size of a node or cluster number
+    uint16_t unused;
+    int64_t n;              // number of nodes
+    int64_t m;              // number of edges before any cut
+    int64_t num_clusters;   // clusters in the whole hierarchy
+    int64_t num_levels;
+    int64_t offset[DENDRO_NUM_SECTIONS];  // byte offset of each array
+
+} DendroHeader;
+
+// the hierarchy of a run, as it is being built
+typedef struct {
+
+    node_t n;
+    edge_t m;
+    node_t *cluster;        // size = |V|; current cluster of each node
+    node_t *parent;         // parent of each cluster, -1 for a component
+    node_t *birth;          // level at which each cluster appeared
+    node_t num_clusters;
+    node_t cap;             // clusters `parent` and `birth` hold
+    DendroLevel *levels;
+    node_t num_levels;
+    Vector cuts;            // (src, dest) of every edge cut so far
+
+    // scratch space, indexed by union-find root or by cluster
+    node_t *piece;          // cluster of the component of each root
+    node_t *pieces;         // number of components of each cluster
+    double *degree_sum;     // sum of degrees in each cluster
+
+} Dendrogram;
+
+// a mapped dendrogram file
+typedef struct {
+
+    MappedFile mf;
+    DendroHeader *hdr;
+    node_t *id;
+    node_t *leaf;
+    node_t *parent;
+    node_t *birth;
+    DendroLevel *levels;
+
+} DendroFile;
+
+// write the hierarchy to `path`, with `idmap` giving the original ids
+void writeDendrogram(Dendrogram *d, node_t *idmap, char *path);
+
+void freeDendrogram(Dendrogram *d);
+
+// map the dendrogram file at `path`; exits on a malformed file
+void mapDendrogramFile(char *path, DendroFile *df);
+
+// Fill `label` with the community of every node at `level`, numbering
+// the communities by their first node; return their number.
+node_t dendrogramPartition(DendroFile *df, node_t level, node_t *label);
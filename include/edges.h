@@ -1,39 +1,50 @@
 ///////////////////////////////////////
 // EDGE HANDLING
 
-// id map tmp storage
-typedef struct {
-
-    ENTRY *entries;
-    int count;
-    int size;
-
-} IdmapStorage;
-
-
-void newIdmapStorage(IdmapStorage *storage, int size);
-void freeIdmapStorage(IdmapStorage *storage);
-void addIdmapEntry(IdmapStorage *storage, ENTRY *ep);
-
-
 // struct to hold edgelist when converting file to CRS graph
 typedef struct {
 
-    int *nodes[2];  // start and end nodes
-    int length;     // number of edges
-    int *id;        // edge ids
+    node_t *nodes[2];   // start and end nodes
+    edge_t length;      // number of edges
+    edge_t *id;         // edge ids
 
 } EdgeList;
 
 #define ICOL    0
 #define JCOL    1
 
+// An edge list read from a pipe, with its ids mapped block by block as
+// they arrive instead of all at once at the end (see `internEdges`).
+// Every id gets a provisional number in order of first appearance, and
+// each edge is stored as provisional ids oriented by original id -- the
+// order the contiguous ids will follow -- with a self-loop stored as
+// (-1, its node). The edges of each low end, which make up its upper row
+// in the CSR build, are counted on the way. Once the input ends, only the
+// distinct ids are left to sort (see `relabelStreamedIds`).
+typedef struct {
+
+    EdgeList elist;
+    edge_t num_interned;    // leading edges of `elist` interned so far
+    IdMap map;              // original -> provisional id
+    node_t *ids;            // original id of each provisional id
+    edge_t *upper;          // edges whose low end is each provisional id
+    node_t num_ids;
+    node_t cap;             // provisional ids `ids` and `upper` hold
+    edge_t num_loops;
+    node_t *relabel;        // provisional -> contiguous id, once relabelled
+
+} StreamedEdges;
+
 #define IEND (elist, idx) (elist->nodes[ICOL][idx])
 #define JEND (elist, idx) (elist->nodes[JCOL][idx])
 
 
 // allocate space for a new edge list of the given length
-void newEdgeList(EdgeList *elist, int length);
+void newEdgeList(EdgeList *elist, edge_t length);
+
+// grow or shrink an edge list to `length` edges; new edges get their
+// position as id
+void resizeEdgeList(EdgeList *elist, edge_t length);
 
 // reorder id array s.t. the value at each index is the index (0->m-1)
 void resetEdgeIds(EdgeList *elist);
@@ -48,16 +59,30 @@ void freeEdgeList(EdgeList *elist);
 void sortEdges(EdgeList *elist, int column);
 
 // find largest value in i or j column
-int findLargestEndpoint(EdgeList *elist, int column);
+node_t findLargestEndpoint(EdgeList *elist, int column);
+
+// Return an array with all unique node ids sorted in ascending order,
+// and fill `map` with the mapping from those ids to their positions.
+void mapNodeIds(EdgeList *elist, node_t **idmap, node_t *num_nodes, IdMap *map);
+
+// start an empty streamed edge list; the caller sizes `elist`
+void newStreamedEdges(StreamedEdges *s);
+
+// intern the ids of the edges of `s->elist` up to `count`
+void internEdges(StreamedEdges *s, edge_t count);
+
+// Number the interned ids in ascending order of original id: fill
+// `s->relabel`, and hand over the sorted original ids as `*ids`. The id
+// map is freed.
+void relabelStreamedIds(StreamedEdges *s, node_t **ids);
 
-// Return an array with all unique node ids sorted in ascending order.
-void mapNodeIds(EdgeList *elist, int **idmap, int *num_nodes, IdmapStorage *store);
+void freeStreamedEdges(StreamedEdges *s);
 
 // look up the assigned node id using the original id read from the graph
-int lookupNodeId(int orig_id);
+node_t lookupNodeId(IdMap *map, node_t orig_id);
 
 // add a mapping from the original node id to a new one
-void addNodeIdToMap(IdmapStorage *store, int orig_id, int node_id);
+void addNodeIdToMap(IdMap *map, node_t orig_id, node_t node_id);
 
 // Print out the edge list (for debugging purposes), up to `num_edges` edges.
-void printEdgeList(EdgeList *elist, int num_edges);
+void printEdgeList(EdgeList *elist, edge_t num_edges);
@@ -0,0 +1,82 @@
+///////////////////////////////////////
+// EXTERNAL-MEMORY SNAPSHOT BUILD
+//
+// Builds a snapshot without ever holding the edge list or the CSR in
+// memory. The input is parsed in batches that fit the memory budget; each
+// batch is expanded into half-edges (src, dst), with a
+// self-loop kept as a single (u, u) marker so that its node still gets an
+// id, sorted, and spilled to a temporary run file next to the output.
+// Merging the runs yields every row in order: a first merge counts the
+// nodes, degrees and surviving edges, a second one streams the rows
+// straight into the memory-mapped snapshot, and the edge ids are indexed
+// in place from there. The result is byte for byte the snapshot
+// `writeSnapshot` produces for the same input.
+//
+// Apart from the batch, memory holds O(n) node state (ids, offsets and
+// the id map).
+
+// one half-edge of a run; runs are sorted by (src, dst)
+typedef struct {
+
+    node_t src;     // original id of the row's node
+    node_t dst;     // original id of the neighbor
+
+} HalfRecord;
+
+// bytes of batch state per input edge: the parsed i and j columns plus
+// both half-edges in two columns, twice over for the radix sort
+#define EXTERNAL_EDGE_BYTES (2*sizeof(node_t) + 2*2*2*sizeof(node_t))
+
+// runs merged at once; more than this are merged in rounds
+#define EXTERNAL_MAX_RUNS   256
+
+// records buffered per run while merging, at least
+#define EXTERNAL_MIN_BUFFER 4096
+
+// smallest accepted budget
+#define EXTERNAL_MIN_BUDGET (16 << 20)
+
+// kinds of merged records, see `nextHalfEdge`
+#define HALF_END    0   // all runs are exhausted
+#define HALF_EDGE   1   // first copy of a half-edge: kept
+#define HALF_LOOP   2   // self-loop marker: gives its node an id only
+#define HALF_DUP    3   // later copy of a half-edge: dropped
+
+// state of one batch-and-spill pass over the input
+typedef struct {
+
+    char *path;         // output snapshot; runs are created next to it
+    node_t *nodes[2];   // parsed i and j columns of the batch
+    edge_t cap;         // edges per batch
+    edge_t count;       // edges in the batch
+    edge_t base;        // input position of the batch's first edge
+    node_t *src;        // half-edges of the batch, in two columns
+    node_t *dst;
+    FILE **runs;        // spilled runs, unlinked already
+    int num_runs;
+    int num_merged;     // leading runs that are merges of fresh ones
+
+} ExternalBuild;
+
+// a run file being read back
+typedef struct {
+
+    FILE *fp;
+    HalfRecord *buf;    // records read ahead
+    size_t cap;         // records `buf` holds
+    size_t len;         // records in `buf`
+    size_t pos;         // next record in `buf`
+
+} RunReader;
+
+// k-way merge of sorted runs through a binary heap of run numbers
+typedef struct {
+
+    RunReader *runs;
+    int num_runs;
+    int *heap;          // runs with records left, smallest record first
+    int heap_size;
+    HalfRecord last;    // last half-edge kept, for spotting duplicates
+    int have_last;
+
+} RunMerge;
@@ -5,20 +5,47 @@
 /********************************************************************/
 
 #include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <search.h>
-
+#include <getopt.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "types.h"
+#include "packed.h"
+#include "order.h"
 #include "queue.h"
+#include "idmap.h"
 #include "vector.h"
+#include "arena.h"
 #include "util.h"
 #include "edges.h"
+#include "stream.h"
+#include "reader.h"
+#include "snapshot.h"
+#include "external.h"
+#include "writer.h"
+#include "dendrogram.h"
+#include "checkpoint.h"
 #include "wqupc.h"
 
 /********************************************************************/
@@ -32,6 +59,8 @@ typedef struct {
     int num_clusters;
     char outfile[200];
     float sample_rate;
+    int num_threads;    // threads used to parse the input
+    int headerless;     // input has no "#nodes #edges" line; count as we go
 
 } InputArgs;
 
@@ -49,31 +78,135 @@ typedef struct {
 // who are the neighbors of i, we must look at i's edgelist, and also
 // every other node's edgelist to see if i is present in it. If we
 // duplicate the edges, then we must only check i's edgelist.
+//
+// A graph owns all of its state; nothing is kept in globals. Independent
+// graphs can be read and processed at the same time on separate threads
+// (see main/stress.c), though fatal errors still exit the process.
 typedef struct {
 
-    int n;          // number of nodes: |V|
-    int m;          // number of edges: |E|
-    int n_s;        // number of nodes in sample
+    node_t n;       // number of nodes: |V|
+    edge_t m;       // number of edges: |E|
+    node_t n_s;     // number of nodes in sample
 
-    int *id;          // size = |V|; ids for all nodes
-    int *index;       // size = |V| + 1
-    int *edges;       // size = 2|E|
-    int *edge_id;     // size = 2|E|
+    node_t *id;       // size = |V|; ids for all nodes
+    edge_t *index;    // size = |V| + 1
+    node_t *edges;    // size = 2|E|
+    edge_t *lower;    // size = |V| + 1; lower halves before each row
+    edge_t *lower_id; // size = |E|; edge id of each lower half
     float *edge_bet;  // size = |E|; index corresponds to edge id
 
-    int *degree;      // size = |V|
-    int *node_id;     // size = |V|
-    int *sample;      // size = user specified at run time
-
-    IdmapStorage idmap;                // hash table entries for node id map
-    IdmapStorage eidmap_store;
-    struct hsearch_data edge_idmap;    // map from "i j" pair to edge id
+    node_t *live;     // size = |V|; slots of each row not cut yet
+    edge_t *slot_id;  // size = 2|E|; edge id of each slot of reordered rows
+                      // both NULL until the first cut, see `cutEdge`
+    node_t *degree;   // size = |V|
+    node_t *node_id;  // size = |V|
+    node_t *id_order; // size = |V|; nodes by ascending original id, or
+                      // NULL when that is 0..n-1, see `orderNodesById`
+    node_t *sample;   // size = user specified at run time
+
+    IdMap idmap;      // original -> contiguous node ids;
+                      // only populated while building
+
+    MappedFile snapshot;  // backing store of the CSR arrays, if loaded
+                          // from a snapshot; otherwise data is NULL
+    MappedFile id_file;   // node id sidecar backing `id` once stored,
+                          // see `storeNodeIds`; otherwise data is NULL
+    PackedAdj packed;     // compressed rows replacing `edges`, if
+                          // packed; otherwise bytes is NULL
+    Arena arena;          // arrays that live as long as the graph:
+                          // node_id, degree, live, slot_id
+    Arena scratch;        // arrays of one Girvan-Newman iteration, reset
+                          // as the next starts: sample, BFS and sort state
 
 } SparseUGraph;
 
+// Edge ids are not stored per slot. Rows are sorted by neighbor, so each
+// row starts with its lower halves (neighbor < node), followed by its
+// upper halves. Numbering the upper halves in slot order gives every edge
+// an id in 0..|E|-1 straight from the slot of its upper half, the one in
+// the row of its smaller endpoint; `lower_id` holds the id of each lower
+// half, row by row, starting at `lower[u]`.
+//
+// Cuts reorder the rows of a plain graph: each row keeps the slots of its
+// live edges, still sorted, in a prefix of `live[u]` slots, and the cut
+// ones after it, so traversals never look at a cut slot. Slots then no
+// longer sit where their ids say, so the first cut copies every slot's id
+// into `slot_id`, which moves along with the slot. Packed rows cannot be
+// reordered; they only keep `live` up to date (see packed.h).
+
+// number of lower halves in the row of u
+#define lowerDegree(graph, u)   ((graph)->lower[(u)+1] - (graph)->lower[u])
+
+// id of the edge at slot i of the row of u
+#define slotEdgeId(graph, u, i) \
+    ((i) < (graph)->index[u] + lowerDegree(graph, u) \
+     ? (graph)->lower_id[(graph)->lower[u] + (i) - (graph)->index[u]] \
+     : (i) - (graph)->lower[(u)+1])
+
+// id of the edge at slot i of the row of u, whether or not rows were
+// reordered by cuts
+#define edgeIdAt(graph, u, i) \
+    ((graph)->slot_id != NULL ? (graph)->slot_id[i] : slotEdgeId(graph, u, i))
+
+// number of edges of u not cut yet
+#define liveDegree(graph, u) \
+    ((graph)->live != NULL ? (graph)->live[u] \
+     : (graph)->index[(u)+1] - (graph)->index[u])
+
+
+#define CSR_MAX_THREADS     64
+#define CSR_MIN_SLICE       (1 << 16)  // fewest input edges worth a thread
+
+struct CsrBuild;
+
+// one thread's share of a CSR build phase
+typedef struct {
+
+    struct CsrBuild *build;
+    edge_t start;       // first input edge of the slice
+    edge_t end;         // one past the last input edge
+    node_t first;       // first node of the slice
+    node_t last;        // one past the last node
+    edge_t count;       // what the phase counted in the slice
+    edge_t base;        // sum of the counts of the earlier slices
+
+} CsrSlice;
+
+// state shared by all threads of a CSR build
+typedef struct CsrBuild {
+
+    EdgeList *elist;
+    SparseUGraph *graph;
+    node_t *relabel;    // streamed input: provisional -> contiguous id
+    edge_t *upper;      // offsets of the rows of edges by their low end
+    node_t *upper_nbr;  // high end of each such edge, -1 if a duplicate
+    edge_t *cursor;     // next free slot of each row during a scatter
+    edge_t *prefix;     // array being prefix-summed
+    int num_slices;
+    CsrSlice slices[CSR_MAX_THREADS];
+
+} CsrBuild;
 
 // Compress edges from edge list into a compressed row storage (CRS) format
-void rowCompressEdges(EdgeList *elist, SparseUGraph *graph);
+// on up to `num_threads` threads; the endpoints in `elist` are rewritten to
+// contiguous node ids. Self-loops and repeated edges (in either direction)
+// are dropped and counted, the edge ids laid out by `indexEdgeSlots`,
+// and `graph->m` updated. The result does not depend on `num_threads`.
+void rowCompressEdges(EdgeList *elist, SparseUGraph *graph, edge_t *num_loops,
+                      edge_t *num_dups, int num_threads);
+
+// Like `rowCompressEdges`, for a streamed edge list whose ids are
+// relabelled already (see `relabelStreamedIds`); its self-loops are
+// counted in `stream->num_loops`.
+void rowCompressStream(StreamedEdges *stream, SparseUGraph *graph, edge_t *num_dups,
+                       int num_threads);
+
+// Fill `lower` and `lower_id` of a graph with sorted rows and nothing cut
+// yet, on up to `num_threads` threads; the caller allocates both.
+void indexEdgeSlots(SparseUGraph *graph, int num_threads);
+
+// sort slots [start, end) of a row by neighbor
+void sortRow(node_t *edges, edge_t start, edge_t end);
 
 // read a sparse undirected graph from an edgelist file
 void readSparseUGraph(InputArgs *args, SparseUGraph *graph);
@@ -81,10 +214,44 @@ void readSparseUGraph(InputArgs *args, SparseUGraph *graph);
 // free all memory allocated for sparse undirected graph
 void freeSparseUGraph(SparseUGraph *graph);
 
-// store the id list for the graph and free the space it occupied
-void storeAndFreeNodeIds(SparseUGraph *graph);
+// renumber the nodes of a freshly read graph in ORDER_* `order`
+void reorderSparseUGraph(SparseUGraph *graph, int order);
 
-// calculate the degree of all nodes in the graph
+// replace `edges` of a freshly read graph by packed rows
+void packSparseUGraph(SparseUGraph *graph);
+
+// free the packed rows, if any
+void freePackedAdj(PackedAdj *adj);
+
+// return 1 if the file at `path` is a binary CSR snapshot, else 0
+int isSnapshotFile(char *path);
+
+// write the CSR arrays of a freshly read graph to a snapshot at `path`
+void writeSnapshot(SparseUGraph *graph, char *path);
+
+// Build the snapshot of args->infile at args->outfile out of core, in
+// about `budget` bytes of memory plus O(n) node state; see external.h
+void buildSnapshotExternal(InputArgs *args, size_t budget);
+
+// map a snapshot and point the CSR arrays of the graph into the mapping
+void loadSnapshot(char *path, SparseUGraph *graph);
+
+// Move the id array of the graph to an unlinked sidecar next to the file
+// `near` (in $TMPDIR if NULL) and point `id` into a mapping of it; return
+// 0 on success, else -1 with the array left in memory. Snapshots already
+// map their ids and need no sidecar.
+int storeNodeIds(SparseUGraph *graph, char *near);
+
+// Find the nodes in ascending original id order and start `node_id` in
+// it, so that degree ties in the sample break by original id whatever
+// the node numbering; call again after renumbering
+void orderNodesById(SparseUGraph *graph);
+
+// start `node_id` over in ascending original id order
+void resetNodeOrder(SparseUGraph *graph);
+
+// calculate the live degree of all nodes in the graph, in `node_id` order,
+// and sort both by it
 void calculateDegreeAndSort(SparseUGraph *graph);
 
 // sorts nodes based on degree
@@ -103,16 +270,31 @@ void freeSparseUGraph(SparseUGraph *graph);
 void writeSparseUGraph(FILE *outfile);
 
 // return 1 if there is an edge from a to b, else 0
-int hasEdge(SparseUGraph *graph, int a, int b);
+int hasEdge(SparseUGraph *graph, node_t a, node_t b);
 
-// look up the id of the edge (src, dest)
-int findEdgeId(SparseUGraph *graph, int src, int dest);
+// Start keeping track of cuts in `live` (and, unless packed, `slot_id`);
+// `cutEdge` calls this on the first cut.
+void newLiveRows(SparseUGraph *graph);
+
+// Move the slot of v in the row of u out of the live prefix, shifting the
+// live slots after it down so the prefix stays sorted, and mark it with
+// -`iteration`; a plain graph only. Does nothing if no live slot holds v.
+void cutSlot(SparseUGraph *graph, node_t u, node_t v, int iteration);
+
+// join the ends of every edge not cut yet in `uf`
+void unionLiveEdges(SparseUGraph *graph, UnionFind *uf);
+
+// look up the id of the edge (src, dest) by scanning the row of src
+edge_t findEdgeId(SparseUGraph *graph, node_t src, node_t dest);
 
 // return the degree of the node
-int degree(SparseUGraph *graph, int node);
+edge_t degree(SparseUGraph *graph, node_t node);
+
+// print the calls made to the heap wrappers and the arenas of `graph`
+void printAllocStats(SparseUGraph *graph);
 
 // print the graph, up to `num_nodes`
-void printSparseUGraph(SparseUGraph *graph, int num_nodes);
+void printSparseUGraph(SparseUGraph *graph, node_t num_nodes);
 
 // convert a graph to an edgelist format; this loses the id list,
 // so be sure to save it first if you want to use it later
@@ -126,16 +308,22 @@ void graphToEdgeList(SparseUGraph *graph, EdgeList *elist);
 // This will be useful when finding centrality measures.
 // It also allows one to trace back the shortest paths
 // that were found, by using the distance and parent info.
+// All of it lives in an arena and is sized so that nothing grows: a node
+// has at most one predecessor per slot of its row, and every node is
+// queued and stacked at most once.
 typedef struct {
 
-    int *parent;        // index represents node; value is index of parent
-    int *distance;      // distance from node n to src
-    int src;            // the root node of the search
-    int n;              // number of nodes in the graph searched
+    node_t *parent;     // index represents node; value is index of parent
+    node_t *distance;   // distance from node n to src
+    node_t src;         // the root node of the search
+    node_t n;           // number of nodes in the graph searched
     int *sigma;         // number of shortest paths from src through each node
-    Vector *pred;       // predecessors (all possible parents, not just left-most).
+    Vector *pred;       // predecessors (all possible parents, not just left-most),
+                        // stored as (parent, edge id) pairs so the edge
+                        // never has to be looked up again
     Vector stack;       // popping should return nodes in order of
                         // non-increasing distance from src
+    Queue queue;        // nodes discovered but not yet explored
 
 } BFSInfo;
 
@@ -146,11 +334,9 @@ typedef struct {
 // this assumes the grpah size has not changed.
 void resetBFSInfo(BFSInfo *info);
 
-// allocate new BFSInfo struct, setting `src` node for search root
-void newBFSInfo(BFSInfo *info, int n);
-
-// free BFSInfo struct
-void freeBFSInfo(BFSInfo *info);
+// carve a new BFSInfo struct for searches of `graph` out of `arena`; it
+// is released with the arena
+void newBFSInfo(BFSInfo *info, SparseUGraph *graph, Arena *arena);
 
 // Perform a BFS on the sparse undirected graph and return
 // the information discovered. The src node is passed with
@@ -158,7 +344,7 @@ void freeBFSInfo(BFSInfo *info);
 void bfs(SparseUGraph *graph, BFSInfo *info);
 
 // print out the path from the target node to the src node
-void printShortestPath(BFSInfo *info, int dest);
+void printShortestPath(BFSInfo *info, node_t dest);
 
 // print out number of shortest paths
 void printShortestPathCounts(BFSInfo *info);
@@ -171,13 +357,13 @@ void printBFSStack(BFSInfo *info);
 void printPredecessors(BFSInfo *info);
 
 // calculate modularity score for a graph
-float modularity(SparseUGraph *graph, Vector *communities, int num_comm);
+float modularity(SparseUGraph *graph, Vector *communities, node_t num_comm);
 
 // returns actual number of edges for a node in a community
-int getEdgesInComm(SparseUGraph *graph, int node);
+edge_t getEdgesInComm(SparseUGraph *graph, node_t node);
 
 // returns the expected number of random edges
-int getDegreeInNetwork(SparseUGraph *graph, int node);
+edge_t getDegreeInNetwork(SparseUGraph *graph, node_t node);
 
 // Calculate edge betweenness centrality using sampling
 // note that multiple calls calculate multiple times.
@@ -223,15 +409,38 @@ void labelDTZidx(SparseUGraph *graph, kMedoidInfo *k_med, DTZ *dtz_idx);
 // Use the Girvan Newman (2004) algorithm to divisely
 // cluster the graph into k partitions.
 // Returns the number of communities found (may not be k).
-int girvanNewman(SparseUGraph *graph, int k, float sample_rate, Vector **comms);
+// With a dendrogram `dendro` (may be NULL), also record every split.
+// With checkpointing `ckpt` (may be NULL), write checkpoints as it goes,
+// and first resume from the one `ckpt` was loaded from, if any.
+node_t girvanNewman(SparseUGraph *graph, node_t k, float sample_rate, Vector **comms,
+                    Dendrogram *dendro, Checkpoint *ckpt);
 
 // Build up the communities from the divided graph
 // using a union-find data structure
-int labelCommunities(SparseUGraph *graph, Vector **comms);
+node_t labelCommunities(SparseUGraph *graph, Vector **comms);
+
+// start the hierarchy of a graph with no edges cut yet
+void newDendrogram(Dendrogram *d, SparseUGraph *graph);
+
+// Record the edges cut by `iteration`, given as (src, dest) pairs in
+// `cut`, and the splits they caused.
+void updateDendrogram(Dendrogram *d, SparseUGraph *graph, Vector *cut,
+                      int iteration);
+
+// start checkpointing a run on `graph` to `path` every `interval` seconds
+void newCheckpoint(Checkpoint *c, SparseUGraph *graph, char *path, double interval);
+
+// Load the checkpoint at `path` into `c` and the betweenness into `graph`,
+// leaving the cuts for `girvanNewman` to reapply. Exits if it belongs to
+// another graph or to a run with another k or sample rate.
+void loadCheckpoint(Checkpoint *c, SparseUGraph *graph, char *path, node_t k,
+                    float sample_rate);
 
-// print out node community membership to outfile
-void writeCommunities(int *idmap, Vector *comms, int k, char *outfile);
+// Write the state in `c` and the betweenness of `graph` to a checkpoint;
+// return 0, or -1 after a warning if it could not be written.
+int writeCheckpoint(Checkpoint *c, SparseUGraph *graph);
 
-// Cut an edge from the graph by marking it with the negative
-// of the iteration number in which it was cut.
-void cutEdge(SparseUGraph *graph, int src, int dest, int iteration);
+// Cut an edge from the graph: move its two slots out of the live
+// prefixes of their rows and mark them with the negative of the iteration
+// number in which it was cut (see `cutSlot`).
+void cutEdge(SparseUGraph *graph, node_t src, node_t dest, int iteration);
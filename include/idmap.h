@@ -0,0 +1,50 @@
+///////////////////////////////////////
+// NODE ID MAP
+//
+// Maps original node ids (as read from the input file) to contiguous
+// node ids 0..n-1. Compact id ranges use a direct array indexed by the
+// original id; anything sparser uses an open-addressing hash table with
+// linear probing. Either way the map owns all of its storage, and
+// lookups never allocate.
+
+// use a direct array when the id range is at most this many times the
+// number of ids (the hash table needs ~4 node_t per id anyway)
+#define IDMAP_DENSE_FACTOR  4
+
+// hash table slot; keeping key and value together costs one cache
+// miss per probe instead of two
+typedef struct {
+
+    node_t key;     // original id
+    node_t value;   // contiguous id; -1 marks an empty slot
+
+} IdMapSlot;
+
+typedef struct {
+
+    IdMapSlot *slots;   // hashed: open-addressing table; NULL if dense
+    node_t *values;     // dense: contiguous id per original id, or -1
+    node_t cap;         // number of slots or dense entries
+    node_t count;       // number of ids in the map
+    node_t min_id;      // dense: original id stored at values[0]
+    int dense;          // 1 if `values` is indexed directly by original id
+    int shift;          // hashed: bits in node_t - log2(cap)
+
+} IdMap;
+
+// allocate a map for `count` ids, all in the range [min_id, max_id]
+void newIdMap(IdMap *map, node_t count, node_t min_id, node_t max_id);
+
+// free the storage owned by the map
+void freeIdMap(IdMap *map);
+
+// add a mapping from the original node id to a contiguous one
+void idMapInsert(IdMap *map, node_t orig_id, node_t node_id);
+
+// Make room for `count` ids in a hashed map, rehashing into a table twice
+// the size whenever it would fill past 1/2. For maps whose id count is
+// not known up front.
+void idMapReserve(IdMap *map, node_t count);
+
+// return the contiguous id mapped to `orig_id`, or -1 if it is unknown
+node_t idMapLookup(IdMap *map, node_t orig_id);
@@ -0,0 +1,25 @@
+///////////////////////////////////////
+// NODE REORDERING
+//
+// Contiguous ids follow the sorted original ids, which scatters the
+// neighbors of a node across the per-node arrays that `bfs` touches on
+// every edge. A reordering renumbers the nodes so that nodes explored
+// together sit close together, and rewrites `index`, `edges` and `id`
+// to match; `id` keeps mapping every node back to its original id. The
+// sample still ranks degree ties by original id (see `orderNodesById`),
+// so a reordering changes the speed of a run but not its communities.
+
+#define ORDER_NONE      0   // keep sorted original-id order
+#define ORDER_DEGREE    1   // descending degree: hubs share cache lines
+#define ORDER_BFS       2   // breadth-first from the largest hub of each
+                            // component
+#define ORDER_RCM       3   // reverse Cuthill-McKee: BFS from the smallest
+                            // degree node, neighbors by ascending degree,
+                            // reversed; keeps the row bandwidth low
+#define NUM_ORDERS      4
+
+// names accepted by `parseOrder`, indexed by ORDER_*
+extern const char *order_names[NUM_ORDERS];
+
+// return the ORDER_* value named `name`, or -1
+int parseOrder(const char *name);
@@ -0,0 +1,62 @@
+///////////////////////////////////////
+// PACKED ADJACENCY
+//
+// Optional compressed form of the `edges` array. Each row is a byte
+// stream with one varint per slot: the zigzagged change in neighbor from
+// the previous slot (the row's own node for the first). Rows are sorted
+// by neighbor, so the gaps are small and mostly fit one byte. `index` is
+// kept as is: it still gives degrees and slot numbers, and with them edge
+// ids (see `slotEdgeId`); a cut edge is recorded by setting its slots'
+// bits in `dead`, since the byte stream cannot be marked in place, let
+// alone reordered into live and cut slots like plain rows are.
+
+typedef struct {
+
+    uint8_t *bytes;     // varint stream of every row; NULL if not packed
+    size_t *start;      // size = |V| + 1; byte offset of each row
+    uint64_t *dead;     // size = 2|E| bits; slots of edges that were cut
+    size_t size;        // bytes used by `bytes`
+
+} PackedAdj;
+
+// varints are little-endian groups of 7 bits, high bit set on all but
+// the last byte
+#define VARINT_MAX_BYTES    10
+
+#define zigzag(x)       (((uint64_t)(x) << 1) ^ (uint64_t)((int64_t)(x) >> 63))
+#define unzigzag(v)     ((int64_t)((v) >> 1) ^ -(int64_t)((v) & 1))
+
+#define slotIsDead(adj, slot) \
+    (((adj)->dead[(slot) >> 6] >> ((slot) & 63)) & 1)
+#define markSlotDead(adj, slot) \
+    ((adj)->dead[(slot) >> 6] |= (uint64_t)1 << ((slot) & 63))
+
+// decode one varint at `p` into `val`; return the byte after it
+static inline const uint8_t *
+readVarint(const uint8_t *p, uint64_t *val)
+{
+    uint64_t v = *p & 0x7f;
+    int shift = 7;
+
+    while (*p++ & 0x80) {
+        v |= (uint64_t)(*p & 0x7f) << shift;
+        shift += 7;
+    }
+    *val = v;
+    return p;
+}
+
+// decode the slot at `p`, advancing the neighbor `nbr` of the previous
+// slot; return the start of the next slot
+static inline const uint8_t *
+unpackSlot(const uint8_t *p, node_t *nbr)
+{
+    uint64_t v;
+
+    p = readVarint(p, &v);
+    *nbr += (node_t)unzigzag(v);
+    return p;
+}
+
+// encode `val` at `p`; return the byte after it
+uint8_t *writeVarint(uint8_t *p, uint64_t val);
@@ -2,20 +2,20 @@
 
 typedef struct {
 
-    int *data;	/* queue contents */
-    int size;   /* number of elements */
-    int count;  /* number of queue elements */
-    int first;  /* position of first element */
-    int last;   /* position of last element */
+    node_t *data;	/* queue contents */
+    node_t size;    /* number of elements */
+    node_t count;   /* number of queue elements */
+    node_t first;   /* position of first element */
+    node_t last;    /* position of last element */
 
 } Queue;
 
 
-void initQueue(Queue *q, int size);
+void initQueue(Queue *q, node_t size);
 void newQueue(Queue *q);
 void freeQueue(Queue *q);
-void enqueue(Queue *q, int x);
-int dequeue(Queue *q);
+void enqueue(Queue *q, node_t x);
+node_t dequeue(Queue *q);
 void doubleQueueSize(Queue *q);
 int queueIsEmpty(Queue *q);
 void printQueue(Queue *q);
@@ -0,0 +1,89 @@
+///////////////////////////////////////
+// EDGE LIST FILE READING
+
+// read-only memory mapping of an entire input file
+typedef struct {
+
+    char *data;     // start of the mapping (NULL for an empty file)
+    size_t size;    // number of bytes mapped
+
+} MappedFile;
+
+// Map the file at `path` into memory; return 0 on success, else -1.
+// A `writable` mapping is private: writes are copy-on-write and never
+// reach the file.
+int mapFile(const char *path, MappedFile *mf, int writable);
+
+// release a mapping created by `mapFile`
+void unmapFile(MappedFile *mf);
+
+// Scan a (possibly signed) decimal integer, skipping leading whitespace
+// the same way `scanf("%ld")` does. Return a pointer just past the last
+// digit, or NULL if no integer starts before `end`.
+const char *scanInt(const char *p, const char *end, int64_t *val);
+
+// Skip whitespace and whole comment lines, i.e. lines whose first
+// non-blank character is '#' or '%' (SNAP and MatrixMarket style).
+// Return the first byte of the next token, or `end`.
+const char *skipComments(const char *p, const char *end);
+
+// Scan up to `max` "i j" pairs from [p, end) into the `icol` and `jcol`
+// arrays, skipping comment lines. Return the number of pairs scanned;
+// `*stop` is set to the first unconsumed byte. Ids too wide for node_t
+// are an error.
+edge_t scanEdges(const char *p, const char *end, node_t *icol, node_t *jcol,
+                 edge_t max, const char **stop);
+
+// Scan the "#nodes #edges" line at the start of [p, end), skipping any
+// comments before it, and range-check both counts. Return a pointer just
+// past the header; a missing header is an error.
+const char *scanHeader(const char *p, const char *end, char *path,
+                       node_t *num_nodes, edge_t *num_edges);
+
+// fail unless only whitespace and comments are left in [stop, end)
+void checkConsumed(const char *stop, const char *end, char *path);
+
+// One newline-aligned slice of an edgelist file, parsed by its own
+// thread into private columns that are later copied into the EdgeList.
+typedef struct {
+
+    const char *start;  // first byte of the chunk
+    const char *end;    // one past the last byte of the chunk
+    node_t *nodes[2];   // private i and j columns
+    edge_t count;       // number of edges parsed
+    edge_t cap;         // space allocated in each column
+    edge_t offset;      // position of this chunk's first edge in the EdgeList
+    const char *stop;   // first byte the parser could not consume
+    EdgeList *elist;    // destination of the concatenated chunks
+
+} ParseChunk;
+
+// chunks smaller than this are not worth a thread of their own
+#define MIN_CHUNK_BYTES (1 << 20)
+
+// initial guess at the bytes per edge line, used to size the edge
+// buffers when the file does not declare its edge count
+#define EDGE_BYTES_GUESS    12
+
+// parse a whole chunk into its private columns (pthread entry point)
+void *parseChunk(void *chunk);
+
+// copy a parsed chunk into its slice of the EdgeList (pthread entry point)
+void *storeChunk(void *chunk);
+
+// Read an edgelist file whose first line holds "#nodes #edges" into a
+// newly allocated edge list, without going through stdio. The edges are
+// split into newline-aligned chunks parsed by up to `num_threads` threads.
+// gzip and zstd files are decompressed on a producer thread and parsed
+// block by block as they arrive. A `headerless` file has no count line:
+// the edge buffers grow as edges are found, `*num_edges` is set to the
+// number found and `*num_nodes` to 0 (it is known once ids are mapped).
+void readEdgeListFile(char *path, EdgeList *elist, node_t *num_nodes,
+                      edge_t *num_edges, int num_threads, int headerless);
+
+// Read an edgelist from a pipe (see `isStreamInput`) into `stream`,
+// interning the ids of every block while the writer produces the next, so
+// that only the relabelling is left once the input ends. Otherwise like
+// `readEdgeListFile`.
+void readEdgeStream(char *path, StreamedEdges *stream, node_t *num_nodes,
+                    edge_t *num_edges, int headerless);
@@ -0,0 +1,75 @@
+///////////////////////////////////////
+// BINARY CSR SNAPSHOTS
+//
+// A snapshot is a header followed by the `id`, `index`, `edges`, `lower`
+// and `lower_id` arrays of a SparseUGraph, each starting on a
+// SNAPSHOT_ALIGN boundary. Loading maps the file and points the graph
+// arrays straight into the mapping, so nothing is parsed or copied and
+// concurrent runs on the same graph share the page cache.
+
+#define SNAPSHOT_MAGIC      "cdcsr\r\n"   // 8 bytes including the NUL
+#define SNAPSHOT_VERSION    2   // 1 stored an edge id per slot
+#define SNAPSHOT_ALIGN      64
+
+// array sections, in file order
+#define SNAP_ID             0
+#define SNAP_INDEX          1
+#define SNAP_EDGES          2
+#define SNAP_LOWER          3
+#define SNAP_LOWER_ID       4
+#define SNAP_NUM_SECTIONS   5
+
+typedef struct {
+
+    char magic[8];
+    uint32_t version;
+    uint16_t node_bytes;    // size of a node id (`id` and `edges`)
+    uint16_t offset_bytes;  // size of an offset or edge id (`index`,
+                            // `lower` and `lower_id`)
+    int64_t n;              // number of nodes: |V|
+    int64_t m;              // number of edges: |E|
+    int64_t offset[SNAP_NUM_SECTIONS];  // byte offset of each array
+
+} SnapshotHeader;
+
+// Fill in the header of a snapshot of an n node, m edge graph, with every
+// section on an aligned boundary. Return the size of the whole file.
+int64_t layoutSnapshot(SnapshotHeader *hdr, node_t n, edge_t m);
+
+// Every binary format here (snapshots, id sidecars, labels, dendrograms
+// and checkpoints) is a header followed by arrays on SNAPSHOT_ALIGN
+// boundaries, laid out and written with these two.
+
+// round `offset` up to the next section boundary
+#define alignSection(offset) \
+    (((offset) + SNAPSHOT_ALIGN-1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN)
+
+// Write `size` bytes of `data` at `offset`, zero-padding from the current
+// position of the file. On failure, exit naming the file `path`, or
+// return -1 if `path` is NULL; else return 0.
+int writeSection(FILE *fpout, int64_t offset, const void *data, size_t size,
+                 const char *path);
+
+///////////////////////////////////////
+// NODE ID SIDECARS
+//
+// The original id of every node, needed only to translate the output, is
+// written to a binary sidecar: a header followed by the `id` array on a
+// SNAPSHOT_ALIGN boundary. The graph then maps the sidecar instead of
+// keeping the array on the heap, so its pages are only faulted in when
+// the output is written. The sidecar is unlinked as soon as it is
+// mapped; nothing is left behind, even if the run is killed.
+
+#define IDS_MAGIC           "cdids\r\n"   // 8 bytes including the NUL
+#define IDS_VERSION         1
+#define IDS_TEMPLATE        ".ids.XXXXXX"  // mkstemp suffix of a sidecar
+
+typedef struct {
+
+    char magic[8];
+    uint32_t version;
+    uint16_t node_bytes;    // size of a node id
+    uint16_t unused;
+    int64_t n;              // number of ids
+
+} IdsHeader;
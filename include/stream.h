@@ -0,0 +1,66 @@
+///////////////////////////////////////
+// COMPRESSED INPUT STREAMS
+//
+// A producer thread decompresses the input into fixed-size blocks and
+// hands them to the parser through a bounded ring, so decompression
+// overlaps with parsing. Input from a pipe (stdin, given as "-", or a
+// FIFO) goes through the same ring, plain or gzip, so that it is parsed
+// while the writer is still producing it. Every block ends on a line
+// break (the partial last line is carried into the next block), so
+// blocks can be parsed independently of each other.
+
+#define STREAM_BLOCK_SIZE   (4 << 20)   // bytes of input per block
+#define STREAM_RING_SLOTS   4           // blocks in flight
+
+// input formats, told apart by their leading magic bytes
+#define FORMAT_PLAIN        0
+#define FORMAT_GZIP         1
+#define FORMAT_ZSTD         2
+#define FORMAT_STREAM       3   // a pipe; never read ahead to find out
+
+// input path standing for stdin
+#define STDIN_PATH          "-"
+
+typedef struct {
+
+    char *data;     // STREAM_BLOCK_SIZE bytes of storage
+    size_t len;     // bytes in use
+
+} StreamBlock;
+
+typedef struct {
+
+    StreamBlock slots[STREAM_RING_SLOTS];
+    int head;       // next block for the consumer
+    int count;      // blocks filled and not yet released
+    int done;       // set once the producer has queued its last block
+    int failed;     // set if the input could not be decompressed
+
+    char *path;     // input file and its format
+    int format;
+
+    pthread_mutex_t lock;
+    pthread_cond_t filled;      // signalled when a block is queued
+    pthread_cond_t released;    // signalled when a block is released
+    pthread_t producer;
+
+} BlockRing;
+
+// return 1 if `path` is stdin or a pipe, which can only be read once
+int isStreamInput(char *path);
+
+// return the format of the file at `path`, judging by its magic bytes
+int detectFormat(char *path);
+
+// start a producer thread decompressing the file at `path` into the ring
+void openBlockRing(BlockRing *ring, char *path, int format);
+
+// wait for the next block; return NULL once the input is exhausted or
+// turns out to be corrupt
+StreamBlock *nextBlock(BlockRing *ring);
+
+// hand the block returned by `nextBlock` back to the producer
+void releaseBlock(BlockRing *ring);
+
+// join the producer and free the ring; return 0 unless decompression failed
+int closeBlockRing(BlockRing *ring);
@@ -0,0 +1,40 @@
+///////////////////////////////////////
+// ID AND OFFSET WIDTHS
+//
+// node_t holds node ids (original and contiguous) and node counts;
+// edge_t holds edge ids, edge counts and offsets into the CSR arrays,
+// and is never narrower than node_t. Both are 32 bits by default, which
+// keeps the CSR arrays cache-dense. Build with EDGES64=1 for graphs of
+// 2^30 edges or more, and with NODES64=1 for 64-bit node ids as well.
+// The widths are fixed at compile time, so no kernel pays anything per
+// access for them.
+
+#ifdef NODES64
+#ifndef EDGES64
+#define EDGES64
+#endif
+typedef int64_t node_t;
+#define NODE_MAX    INT64_MAX
+#define PRInode     PRId64
+#define SCNnode     SCNd64
+#else
+typedef int32_t node_t;
+#define NODE_MAX    INT32_MAX
+#define PRInode     PRId32
+#define SCNnode     SCNd32
+#endif
+
+#ifdef EDGES64
+typedef int64_t edge_t;
+#define EDGE_MAX    INT64_MAX
+#define PRIedge     PRId64
+#define SCNedge     SCNd64
+#else
+typedef int32_t edge_t;
+#define EDGE_MAX    INT32_MAX
+#define PRIedge     PRId32
+#define SCNedge     SCNd32
+#endif
+
+// every edge is stored twice in the CSR, and both copies need an offset
+#define MAX_EDGES   (EDGE_MAX / 2)
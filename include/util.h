@@ -1,8 +1,52 @@
 ///////////////////////////////////////
 // UTILITY FUNCTIONS
 
+// LSD radix sort parameters: passes of 8-bit digits over node_t keys
+#define RADIX_BITS          8
+#define RADIX_BUCKETS       (1 << RADIX_BITS)
+#define RADIX_DIGITS        ((int)sizeof(node_t)*8 / RADIX_BITS)
+#define RADIX_MAX_THREADS   64
+#define RADIX_MIN_SLICE     (1 << 18)  // smallest slice worth a thread
+
+struct RadixSort;
+
+// one thread's share of a radix sort pass
+typedef struct {
+
+    struct RadixSort *sort;
+    edge_t start;               // first index of the slice
+    edge_t end;                 // one past the last index
+    edge_t count[RADIX_BUCKETS];    // digit histogram, then scatter offsets
+
+} RadixSlice;
+
+// state shared by all threads of a radix sort
+typedef struct RadixSort {
+
+    node_t *keys[2];    // ping-pong buffers; [src] holds the input
+    node_t *vals1[2];
+    edge_t *vals2[2];
+    int src;            // buffer being read in this pass
+    int shift;          // bit offset of this pass's digit
+    int num_slices;
+    RadixSlice slices[RADIX_MAX_THREADS];
+
+} RadixSort;
+
+// calls made to the allocation wrappers below, by all threads together
+typedef struct {
+
+    uint64_t tcalloc_calls;
+    uint64_t tmalloc_calls;
+    uint64_t trealloc_calls;
+
+} HeapStats;
+
 // print error and exit
-void error(int err_code);
+void error(int err_code) __attribute__((noreturn));
+
+// read the allocation wrapper counts so far
+void getHeapStats(HeapStats *stats);
 
 // attempt to calloc memory, error out if failure
 void *tcalloc(size_t nitems, size_t size);
@@ -13,21 +57,37 @@ void *tmalloc(size_t size);
 // attempt to realloc memory, error out if failure
 void *trealloc(void *ptr, size_t size);
 
+// Return a new name for a temporary file to write and rename to `path`;
+// no other thread or process gets the same one. The caller frees it.
+char *tempPathFor(char *path);
+
 // find the largest number in the array
-int findLargest(int *array, int length);
+node_t findLargest(node_t *array, edge_t length);
 
 // perform an in-place radix sort on the array; result is ascending order
-void radixSort(int *array, int length);
+void radixSort(node_t *array, edge_t length);
+
+// Stable in-place sort of `keys` (ascending) that applies the same
+// permutation to the payload arrays `vals1` and `vals2` (either may be NULL)
+void radixSortKeys(node_t *keys, node_t *vals1, edge_t *vals2, edge_t length);
+
+// like `radixSortKeys`, with the spare buffers taken from `scratch`
+void radixSortKeysIn(node_t *keys, node_t *vals1, edge_t *vals2, edge_t length,
+                     Arena *scratch);
 
 // remove all duplicate values from the integer array
 // return the size of the new array
-void removeDuplicates(int *array, int *length);
+void removeDuplicates(node_t *array, edge_t *length);
+
+// print an array of node ids
+void printArray(node_t *array, edge_t length);
 
-// print an array of integers
-void printArray(int *array, int length);
+// print an array of offsets or edge ids
+void printOffsets(edge_t *array, edge_t length);
 
 
 // ERROR CODES
 #define OOM_ERROR           -1
 #define BAD_FP              -2
 #define INVALID_SAMPLE_SIZE -3
+#define BAD_INPUT           -4
@@ -3,11 +3,12 @@
 
 #define INIT_VECTOR_SIZE    50
 
+// items are edge_t, which is wide enough for node ids and edge ids alike
 typedef struct {
 
-    int *data;
-    int cap;    // amount of space allocated
-    int size;   // amount of space in use
+    edge_t *data;
+    edge_t cap;     // amount of space allocated
+    edge_t size;    // amount of space in use
 
 } Vector;
 
@@ -15,16 +16,16 @@ typedef struct {
 void newVector(Vector *vec);
 
 // allocate space for new vector, with non-default initial size
-void initVector(Vector *vec, int size);
+void initVector(Vector *vec, edge_t size);
 
 // free mem allocation for vector
 void freeVector(Vector *vec);
 
 // append item to end of vector, expanding if necessary
-void vectorAppend(Vector *vec, int item);
+void vectorAppend(Vector *vec, edge_t item);
 
 // pop an item from the vector; don't call on empty vectors
-int vectorPop(Vector *vec);
+edge_t vectorPop(Vector *vec);
 
 // double capacity of vector
 void doubleVectorCap(Vector *vec);
@@ -0,0 +1,102 @@
+///////////////////////////////////////
+// COMMUNITY OUTPUT
+//
+// Community memberships are written as "<original id> <community>\n"
+// lines, community by community. Lines are formatted by hand into large
+// buffers that go out in single `write` calls. The output is cut into
+// rounds of up to WRITER_MAX_THREADS chunks of WRITER_CHUNK_LINES lines;
+// the chunks of a round are formatted in parallel, each into its own
+// buffer, then written in order, so the text does not depend on the
+// number of threads.
+
+#define WRITER_MAX_THREADS  64
+#define WRITER_CHUNK_LINES  (1 << 16)
+
+// longest line: two signed 64-bit integers, a space and a newline
+#define WRITER_LINE_BYTES   (2*20 + 2)
+
+struct CommWriter;
+
+// one thread's chunk of a round
+typedef struct {
+
+    struct CommWriter *writer;
+    edge_t first;       // first line of the chunk
+    edge_t last;        // one past the last line
+    char *buf;          // WRITER_CHUNK_LINES * WRITER_LINE_BYTES bytes
+    size_t len;         // bytes formatted into `buf`
+
+} WriterSlice;
+
+// state shared by all threads of a write
+typedef struct CommWriter {
+
+    node_t *idmap;      // original id of every node
+    Vector *comms;      // members of every community
+    node_t k;           // number of communities
+    edge_t *start;      // size = k + 1; first line of each community
+    int num_slices;
+    WriterSlice slices[WRITER_MAX_THREADS];
+
+} CommWriter;
+
+// format `val` in decimal at `p`; return the byte after it
+char *formatInt(char *p, int64_t val);
+
+// Write the members of communities 0..k-1 to `outfile`, translated
+// through `idmap`, formatting on up to `num_threads` threads.
+void writeCommunities(node_t *idmap, Vector *comms, node_t k, char *outfile,
+                      int num_threads);
+
+///////////////////////////////////////
+// BINARY LABELS
+//
+// The same memberships as a file to be mapped rather than parsed: a
+// header, the original id of every compact node id, and the community of
+// every compact node id as a dense uint32 array, each section on a
+// SNAPSHOT_ALIGN boundary. "Which community is node u in" is then
+// label[u]; the id section translates u back to the input's id.
+
+#define LABELS_MAGIC        "cdlbl\r\n"   // 8 bytes including the NUL
+#define LABELS_VERSION      1
+#define NO_LABEL            UINT32_MAX    // node in no community
+
+// array sections, in file order
+#define LABELS_ID           0
+#define LABELS_LABEL        1
+#define LABELS_NUM_SECTIONS 2
+
+typedef struct {
+
+    char magic[8];
+    uint32_t version;
+    uint16_t node_bytes;    // size of an original id
+    uint16_t label_bytes;   // size of a label: 4
+    int64_t n;              // number of nodes
+    int64_t k;              // number of communities
+    int64_t offset[LABELS_NUM_SECTIONS];  // byte offset of each array
+
+} LabelsHeader;
+
+// a mapped labels file
+typedef struct {
+
+    MappedFile mf;
+    node_t n;
+    node_t k;
+    node_t *id;         // size = n; original id of each node
+    uint32_t *label;    // size = n; community of each node
+
+} LabelsFile;
+
+#define nodeLabel(lf, u)    ((lf)->label[u])
+
+// Write the community of each of the n nodes, and their original ids
+// from `idmap`, to a labels file at `path`.
+void writeLabels(node_t *idmap, node_t n, Vector *comms, node_t k, char *path);
+
+// map the labels file at `path`; exits on a malformed file
+void mapLabelsFile(char *path, LabelsFile *lf);
+
+// release a mapping created by `mapLabelsFile`
+void unmapLabelsFile(LabelsFile *lf);
@@ -0,0 +1,89 @@
+#include "graph.h"
+
+
+// round `size` up to the next multiple of ARENA_ALIGN
+#define alignArena(size) \
+    (((size) + ARENA_ALIGN-1) / ARENA_ALIGN * ARENA_ALIGN)
+
+// first data byte of a block; the header is padded to keep it aligned
+#define blockData(b)    ((char *)(b) + alignArena(sizeof(ArenaBlock)))
+
+void
+newArena(Arena *a, size_t block_size)
+{   // no block is taken until the first piece is asked for
+    memset(a, 0, sizeof(Arena));
+    a->block_size = block_size;
+}
+
+// put a new block of at least `size` bytes in front of the arena
+static void
+newArenaBlock(Arena *a, size_t size)
+{
+    ArenaBlock *b;
+
+    if (size < a->block_size) size = a->block_size;
+    b = tmalloc(alignArena(sizeof(ArenaBlock)) + size);
+    b->next = a->head;
+    b->size = size;
+    b->used = 0;
+    a->head = b;
+    a->blocks++;
+}
+
+void *
+arenaAlloc(Arena *a, size_t size)
+{
+    void *p;
+
+    size = alignArena(size);
+    if (a->head == NULL || a->head->size - a->head->used < size) {
+        newArenaBlock(a, size);
+    }
+    p = blockData(a->head) + a->head->used;
+    a->head->used += size;
+    a->used += size;
+    if (a->used > a->peak) a->peak = a->used;
+    a->allocs++;
+    return p;
+}
+
+void *
+arenaCalloc(Arena *a, size_t nitems, size_t size)
+{
+    void *p = arenaAlloc(a, nitems * size);
+    memset(p, 0, nitems * size);
+    return p;
+}
+
+// free every block of the arena
+static void
+freeArenaBlocks(Arena *a)
+{
+    ArenaBlock *b, *next;
+
+    for (b = a->head; b != NULL; b = next) {
+        next = b->next;
+        free(b);
+    }
+    a->head = NULL;
+}
+
+void
+arenaReset(Arena *a)
+{   // one block is kept; if the round needed more, it is replaced by one
+    // that holds the peak, so the next round fits without the heap
+    if (a->head != NULL && a->head->next != NULL) {
+        freeArenaBlocks(a);
+        newArenaBlock(a, a->peak);
+    }
+    if (a->head != NULL) a->head->used = 0;
+    a->used = 0;
+    a->resets++;
+}
+
+void
+freeArena(Arena *a)
+{
+    freeArenaBlocks(a);
+    a->used = 0;
+}
@@ -1,6 +1,25 @@
 #include "graph.h"
 
 
+// process `child`, reached from `par` over edge `id`: queue it if not
+// already discovered, and record `par` if it is on a shortest path
+static inline void
+visitChild(BFSInfo *info, Queue *q, node_t par, node_t child, edge_t id)
+{
+    if (!discovered(info, child)) {
+        info->parent[child] = par;
+        info->distance[child] = info->distance[par]+1;
+        enqueue(q, child);
+    }
+
+    // on the shortest path? remember the edge id at this slot too
+    if (info->distance[child] == info->distance[par]+1) {
+        vectorAppend(&info->pred[child], par);
+        vectorAppend(&info->pred[child], id);
+        info->sigma[child] += info->sigma[par];
+    }
+}
+
 // Perform a BFS on the sparse undirected graph and return
 // the information discovered.
 void bfs(SparseUGraph *graph, BFSInfo *info)
@@ -8,51 +27,69 @@ void bfs(SparseUGraph *graph, BFSInfo *info)
     assert(graph != NULL);
     if (graph->n <= 0) return;
 
-    Queue q;
-    int i, j, par, child;
+    Queue *q = &info->queue;
+    edge_t i, split, base, end;
+    node_t par, child;
+    PackedAdj *adj = &graph->packed;
+    const uint8_t *p;
 
     // reset the information storage
     resetBFSInfo(info);
 
     // set up queue for the search
-    newQueue(&q);
+    q->first = 0;
+    q->last = q->size - 1;
+    q->count = 0;
     info->distance[info->src] = 0;        // root node has 0 distance to itself
     info->parent[info->src] = info->src;  // root node has no parent
     info->sigma[info->src] = 1;
-    enqueue(&q, info->src);
+    enqueue(q, info->src);
 
     // commence searching
-    while (!queueIsEmpty(&q)) {
-        par = dequeue(&q);
+    while (!queueIsEmpty(q)) {
+        par = dequeue(q);
         vectorAppend(&info->stack, par);
 
-        // explore all children of this node
-        for (i = graph->index[par]; i < graph->index[par+1]; i++) {
-            child = graph->edges[i];
-            if (child < 0) continue;  // account for edges that have been cut
-
-            // process child and queue its children if not already discovered
-            if (!discovered(info, child)) {
-                info->parent[child] = par;
-                info->distance[child] = info->distance[par]+1;
-                enqueue(&q, child);
+        // explore all children of this node: once rows are reordered by
+        // cuts, only the live prefix, with the ids moved along; before,
+        // the lower halves take their edge ids from `lower_id`, the upper
+        // ones from their slot
+        split = graph->index[par] + lowerDegree(graph, par);
+        base = graph->lower[par] - graph->index[par];
+        if (graph->slot_id != NULL) {
+            end = graph->index[par] + graph->live[par];
+            for (i = graph->index[par]; i < end; i++) {
+                visitChild(info, q, par, graph->edges[i], graph->slot_id[i]);
             }
-
-            // on the shortest path?
-            if (info->distance[child] == info->distance[par]+1) {
-                vectorAppend(&info->pred[child], par);
-                info->sigma[child] += info->sigma[par];
+        } else if (adj->bytes == NULL) {
+            for (i = graph->index[par]; i < split; i++) {
+                visitChild(info, q, par, graph->edges[i], graph->lower_id[base + i]);
+            }
+            for (; i < graph->index[par+1]; i++) {
+                visitChild(info, q, par, graph->edges[i], i - graph->lower[par+1]);
+            }
+        } else {  // decode the row as we go
+            p = adj->bytes + adj->start[par];
+            child = par;
+            for (i = graph->index[par]; i < split; i++) {
+                p = unpackSlot(p, &child);
+                if (slotIsDead(adj, i)) continue;
+                visitChild(info, q, par, child, graph->lower_id[base + i]);
+            }
+            for (; i < graph->index[par+1]; i++) {
+                p = unpackSlot(p, &child);
+                if (slotIsDead(adj, i)) continue;
+                visitChild(info, q, par, child, i - graph->lower[par+1]);
             }
         }
     }
-    freeQueue(&q);
 }
 
 void
 resetBFSInfo(BFSInfo *info)
 {   // Zero out all BFS info data, to prepare for new run
     // this assumes the grpah size has not changed.
-    int i;
+    node_t i;
     info->stack.size = 0;
     for (i = 0; i < info->n; i++) {
         info->pred[i].size = 0;
@@ -63,63 +100,55 @@ resetBFSInfo(BFSInfo *info)
 }
 
 void
-newBFSInfo(BFSInfo *info, int n)
-{   // allocate new BFSInfo struct, for size `n` graph.
-    int i;
+newBFSInfo(BFSInfo *info, SparseUGraph *graph, Arena *arena)
+{   // every node gets room for two items (parent, edge id) per slot
+    node_t i, n = graph->n;
+    edge_t *pred_data;
+
     info->n = n;
-    initVector(&info->stack, n);
-    info->parent = tcalloc(n, sizeof(int));
-    info->distance = tcalloc(n, sizeof(int));
-    info->sigma = tcalloc(n, sizeof(int));
-    info->pred = (Vector *)tcalloc(n, sizeof(Vector));
+    info->stack.data = arenaAlloc(arena, n * sizeof(edge_t));
+    info->stack.cap = n;
+    info->stack.size = 0;
+    info->queue.data = arenaAlloc(arena, n * sizeof(node_t));
+    info->queue.size = n;
+    info->parent = arenaCalloc(arena, n, sizeof(node_t));
+    info->distance = arenaCalloc(arena, n, sizeof(node_t));
+    info->sigma = arenaCalloc(arena, n, sizeof(int));
+    info->pred = arenaAlloc(arena, n * sizeof(Vector));
+    pred_data = arenaAlloc(arena, 2 * graph->index[n] * sizeof(edge_t));
     for (i = 0; i < n; i++) {
-        newVector(&info->pred[i]);
-    }
-}
-
-// free BFSInfo struct
-void
-freeBFSInfo(BFSInfo *info)
-{
-    int i;
-    assert(info != NULL);
-
-    free(info->parent);
-    info->parent = NULL;
-    free(info->distance);
-    info->distance = NULL;
-    free(info->sigma);
-    info->sigma = NULL;
-
-    freeVector(&info->stack);
-    for (i = 0; i < info->n; i++) {
-        freeVector(&info->pred[i]);
+        info->pred[i].data = pred_data + 2 * graph->index[i];
+        info->pred[i].cap = 2 * (graph->index[i+1] - graph->index[i]);
+        info->pred[i].size = 0;
     }
-    free(info->pred);
-    info->pred = NULL;
 }
 
 // print out the path from the target node to the src node
 void
-printShortestPath(BFSInfo *info, int dest)
+printShortestPath(BFSInfo *info, node_t dest)
 {
-    int par = dest;
-    printf("path from %d --> %d:\n", dest, info->src);
+    node_t par = dest;
+    printf("path from %" PRInode " --> %" PRInode ":\n", dest, info->src);
     while (par != info->src) {
-        printf("%d ", par);
+        printf("%" PRInode " ", par);
         par = info->parent[par];
     }
-    printf("%d\n", info->src);
+    printf("%" PRInode "\n", info->src);
 }
 
 void
 printPredecessors(BFSInfo *info)
-{   // print out predecessor info from BFS
-    int i;
+{   // print out predecessor info from BFS, as parent(edge id)
+    node_t i;
+    edge_t j;
     printf("predecessors:\n");
     for (i = 0; i < info->n; i++) {
-        printf("%d: ", i);
-        printVector(&info->pred[i]);
+        printf("%" PRInode ": ", i);
+        for (j = 0; j < info->pred[i].size; j += 2) {
+            printf("%" PRIedge "(%" PRIedge ") ",
+                   info->pred[i].data[j], info->pred[i].data[j+1]);
+        }
+        printf("\n");
     }
 }
 
@@ -128,10 +157,10 @@ printPredecessors(BFSInfo *info)
 void
 printBFSStack(BFSInfo *info)
 {
-    int i;
+    edge_t i;
     assert(info != NULL);
     for (i = info->stack.size-1; i >= 0; i--) {
-        printf("%d ", info->stack.data[i]);
+        printf("%" PRIedge " ", info->stack.data[i]);
     }
     printf("\n");
 }
@@ -140,9 +169,9 @@ printBFSStack(BFSInfo *info)
 void
 printShortestPathCounts(BFSInfo *info)
 {
-    int i;
+    node_t i;
     printf("node\tnum_shortest_paths\n");
     for (i = 0; i < info->n; i++) {
-        printf("%d\t%d\n", i, info->sigma[i]);
+        printf("%" PRInode "\t%d\n", i, info->sigma[i]);
     }
 }
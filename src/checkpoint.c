@@ -0,0 +1,261 @@
+#include "graph.h"
+
+
+// seconds on a monotonic clock
+static double
+checkpointClock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// FNV-1a hash of `size` bytes at `data`, continuing from `hash`
+static uint64_t
+hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Fingerprint of the graph as numbered: the original id and degree of
+// every node. Another input, or another ordering of the same one, gives
+// other edge ids and cut pairs, so a checkpoint is only good for a graph
+// with the same fingerprint.
+static uint64_t
+graphFingerprint(SparseUGraph *graph)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    int64_t size[2] = {graph->n, graph->m};
+    edge_t degree;
+    node_t u;
+
+    hash = hashBytes(hash, size, sizeof(size));
+    for (u = 0; u < graph->n; u++) {
+        if (graph->id != NULL) hash = hashBytes(hash, &graph->id[u], sizeof(node_t));
+        degree = graph->index[u+1] - graph->index[u];
+        hash = hashBytes(hash, &degree, sizeof(edge_t));
+    }
+    return hash;
+}
+
+void
+newCheckpoint(Checkpoint *c, SparseUGraph *graph, char *path, double interval)
+{   // start checkpointing a run that has cut nothing yet
+    memset(c, 0, sizeof(Checkpoint));
+    c->path = path;
+    c->interval = interval;
+    c->last = checkpointClock();
+    c->fingerprint = graphFingerprint(graph);
+    newVector(&c->cuts);
+    c->iteration = 1;
+}
+
+void
+logCuts(Checkpoint *c, Vector *cut, int iteration)
+{
+    edge_t i;
+
+    for (i = 0; i + 1 < cut->size; i += 2) {
+        vectorAppend(&c->cuts, cut->data[i]);
+        vectorAppend(&c->cuts, cut->data[i+1]);
+        vectorAppend(&c->cuts, iteration);
+    }
+}
+
+int
+checkpointDue(Checkpoint *c)
+{
+    return checkpointClock() - c->last >= c->interval;
+}
+
+int
+writeCheckpoint(Checkpoint *c, SparseUGraph *graph)
+{   // write the checkpoint through a temporary file renamed over `c->path`
+    CheckpointHeader hdr;
+    CutRecord *cuts;
+    int64_t size[CKPT_NUM_SECTIONS], offset;
+    void *data[CKPT_NUM_SECTIONS];
+    edge_t i;
+    char *tmp;
+    FILE *fpout;
+    int s, ok;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, sizeof(hdr.magic));
+    hdr.version = CHECKPOINT_VERSION;
+    hdr.node_bytes = sizeof(node_t);
+    hdr.n = graph->n;
+    hdr.m = graph->m;
+    hdr.fingerprint = c->fingerprint;
+    hdr.num_clusters = c->num_clusters;
+    hdr.sample_rate = c->sample_rate;
+    hdr.iteration = c->iteration;
+    hdr.edges_cut = c->edges_cut;
+    hdr.label_at = c->label_at;
+    hdr.num_cuts = c->cuts.size / 3;
+    hdr.num_bet = (graph->edge_bet != NULL) ? graph->m : 0;
+
+    cuts = tmalloc((hdr.num_cuts + 1) * sizeof(CutRecord));
+    for (i = 0; i < hdr.num_cuts; i++) {
+        cuts[i].src = c->cuts.data[3*i];
+        cuts[i].dest = c->cuts.data[3*i+1];
+        cuts[i].iteration = c->cuts.data[3*i+2];
+    }
+    data[CKPT_CUTS] = cuts;
+    size[CKPT_CUTS] = hdr.num_cuts * sizeof(CutRecord);
+    data[CKPT_EDGE_BET] = graph->edge_bet;
+    size[CKPT_EDGE_BET] = hdr.num_bet * sizeof(float);
+    data[CKPT_NODE_ID] = graph->node_id;
+    size[CKPT_NODE_ID] = graph->n * sizeof(node_t);
+    offset = sizeof(hdr);
+    for (s = 0; s < CKPT_NUM_SECTIONS; s++) {
+        offset = alignSection(offset);
+        hdr.offset[s] = offset;
+        offset += size[s];
+    }
+
+    tmp = tempPathFor(c->path);
+    fpout = fopen(tmp, "wb");
+    ok = (fpout != NULL);
+    if (ok) {
+        ok = (writeSection(fpout, 0, &hdr, sizeof(hdr), NULL) == 0);
+        for (s = 0; ok && s < CKPT_NUM_SECTIONS; s++) {
+            ok = (writeSection(fpout, hdr.offset[s], data[s], size[s], NULL) == 0);
+        }
+        ok = (fclose(fpout) == 0 && ok && rename(tmp, c->path) == 0);
+    }
+    if (!ok) {
+        // a failed checkpoint costs the progress since the last one, not
+        // the run
+        fprintf(stderr, "unable to write checkpoint %s; carrying on\n", c->path);
+        unlink(tmp);
+    }
+    free(tmp);
+    free(cuts);
+    c->last = checkpointClock();
+    return ok ? 0 : -1;
+}
+
+void
+loadCheckpoint(Checkpoint *c, SparseUGraph *graph, char *path, node_t k,
+               float sample_rate)
+{   // read back a checkpoint written by `writeCheckpoint`
+    MappedFile mf;
+    CheckpointHeader *hdr;
+    CutRecord *cuts;
+    int64_t size[CKPT_NUM_SECTIONS];
+    node_t *node_id;
+    char *seen;
+    edge_t i;
+    int s, ok;
+
+    if (mapFile(path, &mf, 0) < 0) {
+        fprintf(stderr, "Unable to open checkpoint: %s", path);
+        error(BAD_FP);
+    }
+    hdr = (CheckpointHeader *)mf.data;
+    if (mf.size < sizeof(CheckpointHeader)
+        || memcmp(hdr->magic, CHECKPOINT_MAGIC, sizeof(hdr->magic)) != 0) {
+        fprintf(stderr, "%s is not a checkpoint\n", path);
+        error(BAD_INPUT);
+    }
+    if (hdr->version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "%s: unsupported checkpoint version %u\n", path, hdr->version);
+        error(BAD_INPUT);
+    }
+    if (hdr->node_bytes != sizeof(node_t)) {
+        fprintf(stderr, "%s: checkpoint has %u-byte node ids, but this build "
+                "uses %zu (see NODES64)\n", path, hdr->node_bytes, sizeof(node_t));
+        error(BAD_INPUT);
+    }
+    // no count may exceed what the file could hold, so the section sizes
+    // below cannot overflow
+    if (hdr->n < 0 || hdr->n > (int64_t)(mf.size / sizeof(node_t))
+        || hdr->num_cuts < 0 || hdr->num_cuts > (int64_t)(mf.size / sizeof(CutRecord))
+        || hdr->num_bet < 0 || hdr->num_bet > (int64_t)(mf.size / sizeof(float))
+        || hdr->iteration < 1 || hdr->iteration > INT_MAX) {
+        fprintf(stderr, "%s: truncated or corrupt checkpoint\n", path);
+        error(BAD_INPUT);
+    }
+    size[CKPT_CUTS] = hdr->num_cuts * sizeof(CutRecord);
+    size[CKPT_EDGE_BET] = hdr->num_bet * sizeof(float);
+    size[CKPT_NODE_ID] = hdr->n * sizeof(node_t);
+    for (s = 0; s < CKPT_NUM_SECTIONS; s++) {
+        if (hdr->num_cuts > hdr->edges_cut
+            || (hdr->num_bet != 0 && hdr->num_bet != hdr->m)
+            || hdr->offset[s] < (int64_t)sizeof(CheckpointHeader)
+            || hdr->offset[s] > (int64_t)mf.size
+            || hdr->offset[s] + size[s] > (int64_t)mf.size) {
+            fprintf(stderr, "%s: truncated or corrupt checkpoint\n", path);
+            error(BAD_INPUT);
+        }
+    }
+    if (hdr->n != graph->n || hdr->m != graph->m
+        || hdr->fingerprint != c->fingerprint) {
+        fprintf(stderr, "%s: checkpoint is of another graph; resume with the "
+                "same input and node order\n", path);
+        error(BAD_INPUT);
+    }
+    if (hdr->num_clusters != k || hdr->sample_rate != sample_rate) {
+        fprintf(stderr, "%s: checkpoint is of a run with k %" PRId64 " and sample "
+                "rate %g\n", path, hdr->num_clusters, hdr->sample_rate);
+        error(BAD_INPUT);
+    }
+
+    // the cuts are replayed and node_id sampled from as they are, so every
+    // cut must be between nodes of the graph, in an iteration already run
+    // and in order, and node_id must hold every node exactly once
+    cuts = (CutRecord *)(mf.data + hdr->offset[CKPT_CUTS]);
+    node_id = (node_t *)(mf.data + hdr->offset[CKPT_NODE_ID]);
+    ok = 1;
+    for (i = 0; i < hdr->num_cuts && ok; i++) {
+        ok = (cuts[i].src >= 0 && cuts[i].src < graph->n
+              && cuts[i].dest >= 0 && cuts[i].dest < graph->n
+              && cuts[i].iteration >= 1 && cuts[i].iteration < hdr->iteration
+              && (i == 0 || cuts[i].iteration >= cuts[i-1].iteration));
+    }
+    seen = tcalloc(graph->n > 0 ? graph->n : 1, sizeof(char));
+    for (i = 0; i < graph->n && ok; i++) {
+        ok = (node_id[i] >= 0 && node_id[i] < graph->n && !seen[node_id[i]]);
+        if (ok) seen[node_id[i]] = 1;
+    }
+    free(seen);
+    if (!ok) {
+        fprintf(stderr, "%s: corrupt cut log or sampling order in checkpoint\n", path);
+        error(BAD_INPUT);
+    }
+
+    c->num_clusters = k;
+    c->sample_rate = sample_rate;
+    c->iteration = hdr->iteration;
+    c->edges_cut = hdr->edges_cut;
+    c->label_at = hdr->label_at;
+    c->cuts.size = 0;
+    for (i = 0; i < hdr->num_cuts; i++) {
+        vectorAppend(&c->cuts, cuts[i].src);
+        vectorAppend(&c->cuts, cuts[i].dest);
+        vectorAppend(&c->cuts, cuts[i].iteration);
+    }
+
+    // the run goes on adding to the betweenness, so it needs its own copy
+    if (hdr->num_bet > 0) {
+        free(graph->edge_bet);
+        graph->edge_bet = tmalloc(graph->m * sizeof(float));
+        memcpy(graph->edge_bet, mf.data + hdr->offset[CKPT_EDGE_BET],
+               graph->m * sizeof(float));
+    }
+    memcpy(graph->node_id, node_id, graph->n * sizeof(node_t));
+    unmapFile(&mf);
+}
+
+void
+freeCheckpoint(Checkpoint *c)
+{
+    freeVector(&c->cuts);
+}
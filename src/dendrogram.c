@@ -0,0 +1,315 @@
+#include "graph.h"
+
+
+// add a cluster with parent `parent` born at the current level
+static node_t
+newCluster(Dendrogram *d, node_t parent)
+{
+    if (d->num_clusters == d->cap) {
+        d->cap *= 2;
+        d->parent = trealloc(d->parent, d->cap * sizeof(node_t));
+        d->birth = trealloc(d->birth, d->cap * sizeof(node_t));
+        d->pieces = trealloc(d->pieces, d->cap * sizeof(node_t));
+        d->degree_sum = trealloc(d->degree_sum, d->cap * sizeof(double));
+    }
+    d->parent[d->num_clusters] = parent;
+    d->birth[d->num_clusters] = d->num_levels;
+    d->pieces[d->num_clusters] = 0;
+    return d->num_clusters++;
+}
+
+// Modularity of the current clusters in the original graph: the share of
+// edges inside a cluster, less the share expected from the degrees. An
+// edge not cut yet is always inside, a cut one only if both of its ends
+// still are.
+static double
+clusterModularity(Dendrogram *d, SparseUGraph *graph)
+{
+    double inside, expected = 0.0, two_m = 2.0 * d->m;
+    edge_t i;
+    node_t u, c;
+
+    if (d->m == 0) return 0.0;
+    inside = d->m - d->cuts.size/2;
+    for (i = 0; i < d->cuts.size; i += 2) {
+        if (d->cluster[d->cuts.data[i]] == d->cluster[d->cuts.data[i+1]]) inside++;
+    }
+    for (u = 0; u < d->n; u++) {
+        d->degree_sum[d->cluster[u]] = 0.0;
+    }
+    for (u = 0; u < d->n; u++) {
+        d->degree_sum[d->cluster[u]] += graph->index[u+1] - graph->index[u];
+    }
+    for (u = 0; u < d->n; u++) {
+        c = d->cluster[u];
+        expected += (d->degree_sum[c] / two_m) * (d->degree_sum[c] / two_m);
+        d->degree_sum[c] = 0.0;  // count each cluster once
+    }
+    return inside / d->m - expected;
+}
+
+// record the current clusters as a new level
+static void
+addLevel(Dendrogram *d, SparseUGraph *graph, int iteration, node_t num_current)
+{
+    DendroLevel *level;
+
+    d->levels = trealloc(d->levels, (d->num_levels+1) * sizeof(DendroLevel));
+    level = &d->levels[d->num_levels++];
+    level->iteration = iteration;
+    level->num_clusters = num_current;
+    level->edges_cut = d->cuts.size/2;
+    level->modularity = clusterModularity(d, graph);
+}
+
+// Find the components of the graph as it is now, and give every cluster
+// that fell apart a child cluster per component. Return the number of
+// clusters now, or 0 if nothing split.
+static node_t
+splitClusters(Dendrogram *d, SparseUGraph *graph)
+{
+    UnionFind *uf = uf_create(d->n);
+    node_t u, r, c, num_current = 0, num_split = 0;
+
+    unionLiveEdges(graph, uf);
+
+    // count the components of each cluster
+    for (u = 0; u < d->n; u++) {
+        d->piece[u] = -1;
+    }
+    for (u = 0; u < d->n; u++) {
+        r = uf_root(uf, u);
+        if (d->piece[r] >= 0) continue;
+        d->piece[r] = d->cluster[u];
+        if (d->pieces[d->cluster[u]]++ == 0) num_current++;
+        else num_split++;
+    }
+
+    // the components of a split cluster become its children, in order
+    // of their first node
+    if (num_split > 0) {
+        for (u = 0; u < d->n; u++) {
+            d->piece[u] = -1;
+        }
+        for (u = 0; u < d->n; u++) {
+            r = uf_root(uf, u);
+            c = d->cluster[u];
+            if (d->pieces[c] > 1 && d->piece[r] < 0) d->piece[r] = newCluster(d, c);
+            if (d->piece[r] >= 0) d->cluster[u] = d->piece[r];
+        }
+    }
+    for (u = 0; u < d->n; u++) {  // reset the counts for the next call
+        d->pieces[d->cluster[u]] = 0;
+        if (d->parent[d->cluster[u]] >= 0) d->pieces[d->parent[d->cluster[u]]] = 0;
+    }
+    uf_destroy(uf);
+    return (num_split > 0) ? num_current + num_split : 0;
+}
+
+void
+newDendrogram(Dendrogram *d, SparseUGraph *graph)
+{   // start the hierarchy from the components of the uncut graph
+    node_t u, num_current;
+
+    memset(d, 0, sizeof(Dendrogram));
+    d->n = graph->n;
+    d->m = graph->m;
+    d->cap = 16;
+    d->parent = tmalloc(d->cap * sizeof(node_t));
+    d->birth = tmalloc(d->cap * sizeof(node_t));
+    d->pieces = tmalloc(d->cap * sizeof(node_t));
+    d->degree_sum = tmalloc(d->cap * sizeof(double));
+    d->cluster = tmalloc(d->n * sizeof(node_t));
+    d->piece = tmalloc(d->n * sizeof(node_t));
+    newVector(&d->cuts);
+
+    // everything starts in one cluster, which the components split; the
+    // components then become roots and the placeholder is dropped
+    newCluster(d, -1);
+    for (u = 0; u < d->n; u++) {
+        d->cluster[u] = 0;
+    }
+    d->pieces[0] = 0;
+    num_current = splitClusters(d, graph);
+    if (num_current == 0) {  // one component, or no nodes: keep it
+        num_current = (d->n > 0) ? 1 : 0;
+    } else {
+        for (u = 0; u < d->n; u++) {
+            d->cluster[u]--;
+        }
+        d->num_clusters--;
+        memmove(d->parent, d->parent+1, d->num_clusters * sizeof(node_t));
+        memmove(d->birth, d->birth+1, d->num_clusters * sizeof(node_t));
+        for (u = 0; u < d->num_clusters; u++) {
+            d->parent[u] = -1;
+        }
+    }
+    if (d->n == 0) d->num_clusters = 0;
+    addLevel(d, graph, 0, num_current);
+}
+
+void
+updateDendrogram(Dendrogram *d, SparseUGraph *graph, Vector *cut, int iteration)
+{   // log this iteration's cuts and record a level if anything split
+    edge_t i;
+    node_t num_current;
+
+    for (i = 0; i < cut->size; i++) {
+        vectorAppend(&d->cuts, cut->data[i]);
+    }
+    num_current = splitClusters(d, graph);
+    if (num_current > 0) addLevel(d, graph, iteration, num_current);
+}
+
+void
+writeDendrogram(Dendrogram *d, node_t *idmap, char *path)
+{   // write the hierarchy to a dendrogram file at `path`
+    DendroHeader hdr;
+    int64_t size[DENDRO_NUM_SECTIONS], offset;
+    void *data[DENDRO_NUM_SECTIONS];
+    FILE *fpout;
+    int s;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, DENDRO_MAGIC, sizeof(hdr.magic));
+    hdr.version = DENDRO_VERSION;
+    hdr.node_bytes = sizeof(node_t);
+    hdr.n = d->n;
+    hdr.m = d->m;
+    hdr.num_clusters = d->num_clusters;
+    hdr.num_levels = d->num_levels;
+
+    data[DENDRO_ID] = idmap;
+    size[DENDRO_ID] = d->n * sizeof(node_t);
+    data[DENDRO_LEAF] = d->cluster;
+    size[DENDRO_LEAF] = d->n * sizeof(node_t);
+    data[DENDRO_PARENT] = d->parent;
+    size[DENDRO_PARENT] = d->num_clusters * sizeof(node_t);
+    data[DENDRO_BIRTH] = d->birth;
+    size[DENDRO_BIRTH] = d->num_clusters * sizeof(node_t);
+    data[DENDRO_LEVELS] = d->levels;
+    size[DENDRO_LEVELS] = d->num_levels * sizeof(DendroLevel);
+    offset = sizeof(hdr);
+    for (s = 0; s < DENDRO_NUM_SECTIONS; s++) {
+        offset = alignSection(offset);
+        hdr.offset[s] = offset;
+        offset += size[s];
+    }
+
+    fpout = fopen(path, "wb");
+    if (fpout == NULL) {
+        fprintf(stderr, "unable to open dendrogram file: %s", path);
+        error(BAD_FP);
+    }
+    writeSection(fpout, 0, &hdr, sizeof(hdr), path);
+    for (s = 0; s < DENDRO_NUM_SECTIONS; s++) {
+        writeSection(fpout, hdr.offset[s], data[s], size[s], path);
+    }
+    if (fclose(fpout) != 0) {
+        fprintf(stderr, "unable to write dendrogram file: %s\n", path);
+        error(BAD_FP);
+    }
+}
+
+void
+freeDendrogram(Dendrogram *d)
+{
+    free(d->cluster);
+    free(d->parent);
+    free(d->birth);
+    free(d->levels);
+    free(d->piece);
+    free(d->pieces);
+    free(d->degree_sum);
+    freeVector(&d->cuts);
+}
+
+void
+mapDendrogramFile(char *path, DendroFile *df)
+{   // map a dendrogram file and point the arrays into the mapping
+    DendroHeader *hdr;
+    int64_t size[DENDRO_NUM_SECTIONS];
+    node_t u, c;
+    int s, ok;
+
+    if (mapFile(path, &df->mf, 0) < 0) {
+        fprintf(stderr, "Unable to open dendrogram file: %s", path);
+        error(BAD_FP);
+    }
+    hdr = (DendroHeader *)df->mf.data;
+    if (df->mf.size < sizeof(DendroHeader)
+        || memcmp(hdr->magic, DENDRO_MAGIC, sizeof(hdr->magic)) != 0) {
+        fprintf(stderr, "%s is not a dendrogram file\n", path);
+        error(BAD_INPUT);
+    }
+    if (hdr->version != DENDRO_VERSION) {
+        fprintf(stderr, "%s: unsupported dendrogram version %u\n", path, hdr->version);
+        error(BAD_INPUT);
+    }
+    if (hdr->node_bytes != sizeof(node_t)) {
+        fprintf(stderr, "%s: dendrogram has %u-byte node ids, but this build "
+                "uses %zu (see NODES64)\n", path, hdr->node_bytes, sizeof(node_t));
+        error(BAD_INPUT);
+    }
+    size[DENDRO_ID] = hdr->n * sizeof(node_t);
+    size[DENDRO_LEAF] = hdr->n * sizeof(node_t);
+    size[DENDRO_PARENT] = hdr->num_clusters * sizeof(node_t);
+    size[DENDRO_BIRTH] = hdr->num_clusters * sizeof(node_t);
+    size[DENDRO_LEVELS] = hdr->num_levels * sizeof(DendroLevel);
+    for (s = 0; s < DENDRO_NUM_SECTIONS; s++) {
+        if (hdr->n < 0 || hdr->n >= NODE_MAX || hdr->num_clusters < 0
+            || hdr->num_clusters > 2*hdr->n || hdr->num_levels < 1
+            || hdr->offset[s] < (int64_t)sizeof(DendroHeader)
+            || hdr->offset[s] > (int64_t)df->mf.size
+            || hdr->offset[s] + size[s] > (int64_t)df->mf.size) {
+            fprintf(stderr, "%s: truncated or corrupt dendrogram file\n", path);
+            error(BAD_INPUT);
+        }
+    }
+    df->hdr = hdr;
+    df->id = (node_t *)(df->mf.data + hdr->offset[DENDRO_ID]);
+    df->leaf = (node_t *)(df->mf.data + hdr->offset[DENDRO_LEAF]);
+    df->parent = (node_t *)(df->mf.data + hdr->offset[DENDRO_PARENT]);
+    df->birth = (node_t *)(df->mf.data + hdr->offset[DENDRO_BIRTH]);
+    df->levels = (DendroLevel *)(df->mf.data + hdr->offset[DENDRO_LEVELS]);
+
+    // `dendrogramPartition` indexes by all of these: every node must sit
+    // in a cluster, every parent come before its child, and every
+    // component (no parent) be there from the first level
+    ok = 1;
+    for (u = 0; u < hdr->n && ok; u++) {
+        ok = (df->leaf[u] >= 0 && df->leaf[u] < hdr->num_clusters);
+    }
+    for (c = 0; c < hdr->num_clusters && ok; c++) {
+        ok = (df->parent[c] >= -1 && df->parent[c] < c
+              && df->birth[c] >= 0 && df->birth[c] < hdr->num_levels
+              && (df->parent[c] >= 0 || df->birth[c] == 0));
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: corrupt clusters in dendrogram file\n", path);
+        error(BAD_INPUT);
+    }
+}
+
+node_t
+dendrogramPartition(DendroFile *df, node_t level, node_t *label)
+{   // label every node with its community at `level`; return their number
+    node_t c, u, k = 0, num_clusters = df->hdr->num_clusters;
+    node_t *rep = tmalloc(num_clusters * sizeof(node_t));
+    node_t *number = tmalloc(num_clusters * sizeof(node_t));
+
+    // parents come before their children, so one sweep finds the
+    // cluster every cluster belongs to at `level`
+    for (c = 0; c < num_clusters; c++) {
+        rep[c] = (df->birth[c] <= level) ? c : rep[df->parent[c]];
+        number[c] = -1;
+    }
+    for (u = 0; u < df->hdr->n; u++) {
+        c = rep[df->leaf[u]];
+        if (number[c] < 0) number[c] = k++;
+        label[u] = number[c];
+    }
+    free(rep);
+    free(number);
+    return k;
+}
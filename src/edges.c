@@ -3,15 +3,29 @@
 
 // allocate space for a new edge list of the given length
 void
-newEdgeList(EdgeList *elist, int length)
+newEdgeList(EdgeList *elist, edge_t length)
 {
     elist->length = length;
-    elist->nodes[0] = tcalloc(length, sizeof(int));
-    elist->nodes[1] = tcalloc(length, sizeof(int));
-    elist->id = tcalloc(length, sizeof(int));
+    elist->nodes[0] = tcalloc(length, sizeof(node_t));
+    elist->nodes[1] = tcalloc(length, sizeof(node_t));
+    elist->id = tcalloc(length, sizeof(edge_t));
     resetEdgeIds(elist);
 }
 
+void
+resizeEdgeList(EdgeList *elist, edge_t length)
+{   // grow or shrink an edge list to `length` edges
+    edge_t i;
+
+    elist->nodes[0] = trealloc(elist->nodes[0], length * sizeof(node_t));
+    elist->nodes[1] = trealloc(elist->nodes[1], length * sizeof(node_t));
+    elist->id = trealloc(elist->id, length * sizeof(edge_t));
+    for (i = elist->length; i < length; i++) {
+        elist->id[i] = i;
+    }
+    elist->length = length;
+}
+
 void
 freeEdgeList(EdgeList *elist)
 {   // Free the memory allocated for the edgelist.
@@ -24,7 +38,7 @@ freeEdgeList(EdgeList *elist)
 void
 resetEdgeIds(EdgeList *elist)
 {   // reorder id array s.t. the value at each index is the index (0->m-1)
-    int i;
+    edge_t i;
     for (i = 0; i < elist->length; i++) {
         elist->id[i] = i;
     }
@@ -35,13 +49,14 @@ void
 copyEdgeList(EdgeList *cur, EdgeList *new)
 {
     assert(cur != NULL);
-    int i, j;
+    edge_t i;
+    int j;
 
     // first allocate space for the copy
     new->length = cur->length;
-    new->nodes[0] = tcalloc(cur->length, sizeof(int));
-    new->nodes[1] = tcalloc(cur->length, sizeof(int));
-    new->id = tcalloc(cur->length, sizeof(int));
+    new->nodes[0] = tcalloc(cur->length, sizeof(node_t));
+    new->nodes[1] = tcalloc(cur->length, sizeof(node_t));
+    new->id = tcalloc(cur->length, sizeof(edge_t));
 
     // then move over i and j columns
     for (j = 0; j < 2; j++) {
@@ -57,72 +72,32 @@ copyEdgeList(EdgeList *cur, EdgeList *new)
 }
 
 // find largest value in i or j column
-int findLargestEndpoint(EdgeList *elist, int col)
+node_t findLargestEndpoint(EdgeList *elist, int col)
 {
     assert(elist != NULL);
     return findLargest(elist->nodes[col], elist->length);
 }
 
 // sort edges by i column (0) or by j column (1)
-// use radix sort for linear time sorting
+// use radix sort for linear time sorting; the other column and the
+// ids are carried along in the same passes
 void
 sortEdges(EdgeList *elist, int col)
 {
     assert(elist != NULL);
-
-    int i, loc, largest;
-    int base = 10;      /* use a base of 10 */
-    int bucket[base];   /* need one bucket for each of 0-base modulus results */
-    int sig_digit = 1;  /* most significant digit */
-    EdgeList semi_sorted;
-
-    newEdgeList(&semi_sorted, elist->length);
-    largest = findLargestEndpoint(elist, col);
-
-    // loop until we reach highest significant digit
-    while (largest / sig_digit > 0) {
-        memset(bucket, 0, sizeof(bucket));
-
-        // count number of keys/digits that will go into each bucket
-        for (i = 0; i < elist->length; i++)
-            bucket[(elist->nodes[col][i] / sig_digit) % base]++;
-
-        // Add the count of the previous buckets.
-        // This acquires the indices after the end of each bucket location in
-        // the edge list -- similar to count sorting algorithm.
-        for (i = 1; i < base; i++) {
-            bucket[i] += bucket[i-1];
-        }
-
-        // use the buckets to fill a semi sorted edge list
-        for (i = elist->length-1; i >= 0; i--) {
-            loc = --bucket[(elist->nodes[col][i] / sig_digit) % 10];
-            semi_sorted.nodes[col][loc] = elist->nodes[col][i];
-            semi_sorted.nodes[1-col][loc] = elist->nodes[1-col][i];
-            semi_sorted.id[loc] = elist->id[i];
-        }
-
-        for (i = 0; i < elist->length; i++) {
-            elist->nodes[col][i] = semi_sorted.nodes[col][i];
-            elist->nodes[1-col][i] = semi_sorted.nodes[1-col][i];
-            elist->id[i] = semi_sorted.id[i];
-        }
-
-        // move to next significant digit
-        sig_digit *= base;
-    }
-    freeEdgeList(&semi_sorted);
+    radixSortKeys(elist->nodes[col], elist->nodes[1-col], elist->id,
+                  elist->length);
 }
 
 // Return an array with all unique node ids sorted in ascending order.
 // Also set the number of unique nodes after filtering.
 void
-mapNodeIds(EdgeList *elist, int **idmap, int *num_nodes, IdmapStorage *store)
+mapNodeIds(EdgeList *elist, node_t **idmap, node_t *num_nodes, IdMap *map)
 {
     assert(elist != NULL);
-    int i, j;
-    int size = elist->length * 2;
-    int *nodes = tcalloc(size, sizeof(int));
+    edge_t i, j;
+    edge_t size = elist->length * 2;
+    node_t *nodes = tcalloc(size, sizeof(node_t));
 
     // first add node ids from the i column
     for (i = 0; i < elist->length; i++) {
@@ -136,88 +111,144 @@ mapNodeIds(EdgeList *elist, int **idmap, int *num_nodes, IdmapStorage *store)
 
     // now remove duplicates (which sorts) and set results
     removeDuplicates(nodes, &size);
-    *num_nodes = size;
-    *idmap = realloc(nodes, size * sizeof(int));
+    *idmap = trealloc(nodes, size * sizeof(node_t));
+    if (size > NODE_MAX) {
+        fprintf(stderr, "%" PRIedge " distinct node ids do not fit in node_t; "
+                "rebuild with NODES64=1\n", size);
+        error(BAD_INPUT);
+    }
+    *num_nodes = (node_t)size;
 
-    // map actual node ids (from the input file) to contiguous ids
-    hcreate((int)(size + size*0.25 + 0.5));  // make new hash table for ids
-    newIdmapStorage(store, size);
+    // map actual node ids (from the input file) to contiguous ids;
+    // the ids are sorted, so the first and last bound the range
+    if (size == 0) {
+        newIdMap(map, 0, 0, 0);
+        return;
+    }
+    newIdMap(map, size, (*idmap)[0], (*idmap)[size-1]);
     for (i = 0; i < size; i++) {
-        addNodeIdToMap(store, nodes[i], i);
+        addNodeIdToMap(map, (*idmap)[i], i);
     }
 }
 
-int
-lookupNodeId(int orig_id)
-{   // look up the assigned node id using the original id read from the graph
-    ENTRY e, *ep;
-    char node_id_str[10];
-
-    sprintf(node_id_str, "%d", orig_id);
-    e.key = tcalloc(10, sizeof(char));
-    strncpy(e.key, node_id_str, strlen(node_id_str));
-    ep = hsearch(e, FIND);
-    if (ep == NULL) {
-        fprintf(stderr, "unknown node id: %d\n", orig_id);
-        error(EXIT_FAILURE);
+void
+newStreamedEdges(StreamedEdges *s)
+{
+    memset(s, 0, sizeof(StreamedEdges));
+    newIdMap(&s->map, 0, 0, 0);  // hashed; grows with the ids
+    s->cap = 1024;
+    s->ids = tmalloc(s->cap * sizeof(node_t));
+    s->upper = tmalloc(s->cap * sizeof(edge_t));
+}
+
+// return the provisional id of `orig_id`, giving it the next one if new
+static node_t
+internId(StreamedEdges *s, node_t orig_id)
+{
+    node_t id = idMapLookup(&s->map, orig_id);
+
+    if (id >= 0) return id;
+    if (s->num_ids == s->cap) {
+        if (s->cap > NODE_MAX/2) {
+            fprintf(stderr, "more than %" PRInode " distinct node ids do not fit "
+                    "in node_t; rebuild with NODES64=1\n", s->cap);
+            error(BAD_INPUT);
+        }
+        s->cap *= 2;
+        s->ids = trealloc(s->ids, s->cap * sizeof(node_t));
+        s->upper = trealloc(s->upper, s->cap * sizeof(edge_t));
     }
-    free(e.key);
-    return *((int *)ep->data);
+    idMapReserve(&s->map, s->num_ids+1);
+    idMapInsert(&s->map, orig_id, s->num_ids);
+    s->ids[s->num_ids] = orig_id;
+    s->upper[s->num_ids] = 0;
+    return s->num_ids++;
 }
 
 void
-addNodeIdToMap(IdmapStorage *store, int orig_id, int node_id)
-{   // add a mapping from the original node id to a new one
-    ENTRY e, *ep;
-    char node_id_str[10];
-
-    sprintf(node_id_str, "%d", orig_id);
-    e.key = tcalloc(10, sizeof(char));
-    strncpy(e.key, node_id_str, strlen(node_id_str));
-    e.data = tcalloc(1, sizeof(int));
-    *(int *)e.data = node_id;
-    ep = hsearch(e, ENTER);
-    if (ep == NULL) {
-        fprintf(stderr, "node id map hash entry failed\n");
-        error(EXIT_FAILURE);
+internEdges(StreamedEdges *s, edge_t count)
+{   // map, orient and count the edges read since the last call
+    node_t *icol = s->elist.nodes[ICOL], *jcol = s->elist.nodes[JCOL];
+    node_t u, v;
+    edge_t e;
+
+    for (e = s->num_interned; e < count; e++) {
+        u = internId(s, icol[e]);
+        v = internId(s, jcol[e]);
+        if (icol[e] == jcol[e]) {  // only gives its node an id
+            s->num_loops++;
+            icol[e] = -1;
+            jcol[e] = u;
+            continue;
+        }
+        if (icol[e] < jcol[e]) {
+            icol[e] = u;
+            jcol[e] = v;
+        } else {
+            icol[e] = v;
+            jcol[e] = u;
+        }
+        s->upper[icol[e]]++;
     }
-    addIdmapEntry(store, &e);
+    s->num_interned = count;
 }
 
-// Print out the edge list (for debugging purposes), up to `num_edges` edges.
 void
-printEdgeList(EdgeList *elist, int num_edges)
-{
-    assert(elist != NULL);
-    int i;
+relabelStreamedIds(StreamedEdges *s, node_t **ids)
+{   // sort the distinct ids, carrying their provisional ids along
+    node_t i, *order = tmalloc((s->num_ids + 1) * sizeof(node_t));
 
-    num_edges = (num_edges >= elist->length) ? elist->length-1 : num_edges;
-    for (i = 0; i <= num_edges; i++) {
-        printf("%d: (%d, %d)\n",
-               elist->id[i], elist->nodes[0][i], elist->nodes[1][i]);
+    for (i = 0; i < s->num_ids; i++) {
+        order[i] = i;
+    }
+    radixSortKeys(s->ids, order, NULL, s->num_ids);
+    s->relabel = tmalloc((s->num_ids + 1) * sizeof(node_t));
+    for (i = 0; i < s->num_ids; i++) {
+        s->relabel[order[i]] = i;
     }
+    free(order);
+    *ids = trealloc(s->ids, (s->num_ids + 1) * sizeof(node_t));
+    s->ids = NULL;
+    freeIdMap(&s->map);
 }
 
-void newIdmapStorage(IdmapStorage *storage, int size)
+void
+freeStreamedEdges(StreamedEdges *s)
 {
-    storage->entries = tcalloc(size, sizeof(ENTRY));
-    storage->size = size;
-    storage->count = 0;
+    freeEdgeList(&s->elist);
+    freeIdMap(&s->map);
+    free(s->ids);
+    free(s->upper);
+    free(s->relabel);
 }
 
-void freeIdmapStorage(IdmapStorage *storage)
-{
-    int i;
-    for (i = 0; i < storage->count; i++) {
-        free(storage->entries[i].key);
-        free(storage->entries[i].data);
+node_t
+lookupNodeId(IdMap *map, node_t orig_id)
+{   // look up the assigned node id using the original id read from the graph
+    node_t node_id = idMapLookup(map, orig_id);
+    if (node_id < 0) {
+        fprintf(stderr, "unknown node id: %" PRInode "\n", orig_id);
+        error(EXIT_FAILURE);
     }
-    free(storage->entries);
+    return node_id;
 }
 
-void addIdmapEntry(IdmapStorage *storage, ENTRY *ep)
-{
-    assert(storage->count <= storage->size);
-    storage->entries[storage->count++] = *ep;
+void
+addNodeIdToMap(IdMap *map, node_t orig_id, node_t node_id)
+{   // add a mapping from the original node id to a new one
+    idMapInsert(map, orig_id, node_id);
 }
 
+// Print out the edge list (for debugging purposes), up to `num_edges` edges.
+void
+printEdgeList(EdgeList *elist, edge_t num_edges)
+{
+    assert(elist != NULL);
+    edge_t i;
+
+    num_edges = (num_edges >= elist->length) ? elist->length-1 : num_edges;
+    for (i = 0; i <= num_edges; i++) {
+        printf("%" PRIedge ": (%" PRInode ", %" PRInode ")\n",
+               elist->id[i], elist->nodes[0][i], elist->nodes[1][i]);
+    }
+}
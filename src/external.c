@@ -0,0 +1,475 @@
+#include "graph.h"
+
+
+// records staged per write to a run file
+#define RUN_WRITE_RECORDS   4096
+
+static void mergeRuns(ExternalBuild *xb, int first, int count, size_t buf_records);
+
+static FILE *
+newRunFile(char *path)
+{   // create an anonymous temporary file in the directory of `path`
+    char *name = tmalloc(strlen(path) + 16);
+    FILE *fp;
+    int fd;
+
+    sprintf(name, "%s.runXXXXXX", path);
+    fd = mkstemp(name);
+    if (fd < 0 || (fp = fdopen(fd, "w+b")) == NULL) {
+        fprintf(stderr, "unable to create temporary run file %s\n", name);
+        error(BAD_FP);
+    }
+    unlink(name);  // the space is released when the file is closed
+    free(name);
+    return fp;
+}
+
+static void
+writeRecords(FILE *fp, HalfRecord *recs, size_t len)
+{
+    if (fwrite(recs, sizeof(HalfRecord), len, fp) != len) {
+        fprintf(stderr, "unable to write temporary run file\n");
+        error(BAD_FP);
+    }
+}
+
+// Expand the batch into half-edges, sort them by (src, dst) and spill
+// them to a new run: two stable sorts, by dst and then by src.
+static void
+spillBatch(ExternalBuild *xb)
+{
+    HalfRecord *stage;
+    node_t u, v;
+    edge_t e, len = 0, i, k;
+    FILE *fp;
+
+    if (xb->count == 0) return;
+    if (xb->base > MAX_EDGES - xb->count) {
+        fprintf(stderr, "more than %" PRIedge " edges do not fit in edge_t; "
+                "rebuild with EDGES64=1\n", (edge_t)MAX_EDGES);
+        error(BAD_INPUT);
+    }
+    for (e = 0; e < xb->count; e++) {
+        u = xb->nodes[ICOL][e];
+        v = xb->nodes[JCOL][e];
+        xb->src[len] = u;
+        xb->dst[len++] = v;
+        if (u == v) continue;  // a self-loop only marks its node
+        xb->src[len] = v;
+        xb->dst[len++] = u;
+    }
+    radixSortKeys(xb->dst, xb->src, NULL, len);
+    radixSortKeys(xb->src, xb->dst, NULL, len);
+
+    fp = newRunFile(xb->path);
+    stage = tmalloc(RUN_WRITE_RECORDS * sizeof(HalfRecord));
+    for (i = 0; i < len; i += k) {
+        for (k = 0; k < RUN_WRITE_RECORDS && i+k < len; k++) {
+            stage[k].src = xb->src[i+k];
+            stage[k].dst = xb->dst[i+k];
+        }
+        writeRecords(fp, stage, k);
+    }
+    free(stage);
+
+    xb->runs = trealloc(xb->runs, (xb->num_runs+1) * sizeof(FILE *));
+    xb->runs[xb->num_runs++] = fp;
+    xb->base += xb->count;
+    xb->count = 0;
+
+    // Keep the number of open run files bounded: once there are
+    // EXTERNAL_MAX_RUNS fresh runs, fold them into one, after folding the
+    // earlier merged runs too if those have piled up. The batch still
+    // holds the budget, so buffer little.
+    if (xb->num_runs - xb->num_merged == EXTERNAL_MAX_RUNS) {
+        if (xb->num_merged == EXTERNAL_MAX_RUNS) {
+            mergeRuns(xb, 0, EXTERNAL_MAX_RUNS, EXTERNAL_MIN_BUFFER);
+            xb->num_merged = 1;
+        }
+        mergeRuns(xb, xb->num_merged, EXTERNAL_MAX_RUNS, EXTERNAL_MIN_BUFFER);
+        xb->num_merged++;
+    }
+}
+
+// Scan all of [p, end) into the batch, spilling it whenever it fills
+// up. Return the first byte that could not be scanned.
+static const char *
+scanBatches(ExternalBuild *xb, const char *p, const char *end)
+{
+    const char *stop;
+
+    while (1) {
+        xb->count += scanEdges(p, end, xb->nodes[ICOL] + xb->count,
+                               xb->nodes[JCOL] + xb->count,
+                               xb->cap - xb->count, &stop);
+        if (xb->count < xb->cap) return stop;
+        spillBatch(xb);
+        p = stop;
+    }
+}
+
+// Parse the whole input into sorted runs. Return the number of edges
+// read; the declared node count is stored in `*num_nodes`, or -1 if
+// `headerless`.
+static edge_t
+spillInput(ExternalBuild *xb, char *path, int headerless, node_t *num_nodes)
+{
+    MappedFile mf;
+    BlockRing ring;
+    StreamBlock *blk;
+    const char *p, *end;
+    edge_t num_edges = -1;
+    int format, started = 0;
+
+    *num_nodes = -1;
+    format = detectFormat(path);
+    if (format == FORMAT_PLAIN) {
+        if (mapFile(path, &mf, 0) < 0) {
+            fprintf(stderr, "Unable to open graph edgelist: %s", path);
+            error(BAD_FP);
+        }
+        if (mf.data != NULL) madvise(mf.data, mf.size, MADV_SEQUENTIAL);
+        p = mf.data;
+        end = mf.data + mf.size;
+        if (!headerless) p = scanHeader(p, end, path, num_nodes, &num_edges);
+        checkConsumed(scanBatches(xb, p, end), end, path);
+        unmapFile(&mf);
+    } else {  // blocks end on line breaks, so each one is scanned on its own
+        openBlockRing(&ring, path, format);
+        while ((blk = nextBlock(&ring)) != NULL) {
+            p = blk->data;
+            end = p + blk->len;
+            if (!started && !headerless) {
+                p = scanHeader(p, end, path, num_nodes, &num_edges);
+            }
+            started = 1;
+            checkConsumed(scanBatches(xb, p, end), end, path);
+            releaseBlock(&ring);
+        }
+        if (closeBlockRing(&ring) < 0) {
+            fprintf(stderr, "%s: %s\n", path, (format == FORMAT_STREAM)
+                    ? "unreadable, corrupt or truncated input"
+                    : "corrupt or truncated compressed input");
+            error(BAD_INPUT);
+        }
+        if (!started) {
+            fprintf(stderr, "%s: no input\n", path);
+            error(BAD_INPUT);
+        }
+    }
+    spillBatch(xb);
+
+    if (!headerless && xb->base != num_edges) {
+        fprintf(stderr, "%s: header declares %" PRIedge " edges, but the file has %s\n",
+                path, num_edges, (xb->base < num_edges) ? "fewer" : "more");
+        error(BAD_INPUT);
+    }
+    return xb->base;
+}
+
+static int
+recordLess(const HalfRecord *a, const HalfRecord *b)
+{
+    if (a->src != b->src) return a->src < b->src;
+    return a->dst < b->dst;
+}
+
+#define headRecord(merge, h)    (&(merge)->runs[h].buf[(merge)->runs[h].pos])
+
+static void
+siftDown(RunMerge *merge, int i)
+{   // restore the heap below position `i`
+    int child, h = merge->heap[i];
+
+    while ((child = 2*i + 1) < merge->heap_size) {
+        if (child+1 < merge->heap_size
+            && recordLess(headRecord(merge, merge->heap[child+1]),
+                          headRecord(merge, merge->heap[child]))) {
+            child++;
+        }
+        if (!recordLess(headRecord(merge, merge->heap[child]), headRecord(merge, h))) {
+            break;
+        }
+        merge->heap[i] = merge->heap[child];
+        i = child;
+    }
+    merge->heap[i] = h;
+}
+
+static int
+fillRun(RunReader *run)
+{   // read ahead in the run; return 0 once it is exhausted
+    run->len = fread(run->buf, sizeof(HalfRecord), run->cap, run->fp);
+    run->pos = 0;
+    if (run->len == 0 && ferror(run->fp)) {
+        fprintf(stderr, "unable to read temporary run file\n");
+        error(BAD_FP);
+    }
+    return run->len > 0;
+}
+
+// start merging `num_runs` runs from their beginnings, buffering
+// `buf_records` records of each
+static void
+openMerge(RunMerge *merge, FILE **files, int num_runs, size_t buf_records)
+{
+    int r;
+
+    merge->runs = tcalloc(num_runs, sizeof(RunReader));
+    merge->num_runs = num_runs;
+    merge->heap = tmalloc(num_runs * sizeof(int));
+    merge->heap_size = 0;
+    merge->have_last = 0;
+    for (r = 0; r < num_runs; r++) {
+        fflush(files[r]);
+        rewind(files[r]);
+        merge->runs[r].fp = files[r];
+        merge->runs[r].cap = buf_records;
+        merge->runs[r].buf = tmalloc(buf_records * sizeof(HalfRecord));
+        if (fillRun(&merge->runs[r])) merge->heap[merge->heap_size++] = r;
+    }
+    for (r = merge->heap_size/2 - 1; r >= 0; r--) {
+        siftDown(merge, r);
+    }
+}
+
+static int
+mergeNext(RunMerge *merge, HalfRecord *rec)
+{   // pop the smallest record into `rec`; return 0 once all runs are empty
+    RunReader *run;
+
+    if (merge->heap_size == 0) return 0;
+    run = &merge->runs[merge->heap[0]];
+    *rec = run->buf[run->pos++];
+    if (run->pos == run->len && !fillRun(run)) {
+        merge->heap[0] = merge->heap[--merge->heap_size];
+    }
+    if (merge->heap_size > 0) siftDown(merge, 0);
+    return 1;
+}
+
+static void
+closeMerge(RunMerge *merge)
+{   // free the merge buffers; the run files stay open
+    int r;
+    for (r = 0; r < merge->num_runs; r++) {
+        free(merge->runs[r].buf);
+    }
+    free(merge->runs);
+    free(merge->heap);
+}
+
+// Pop the next record into `rec` and return its HALF_* kind. Copies of
+// an edge are adjacent in the merged order, so only the first copy in
+// each row is kept.
+static int
+nextHalfEdge(RunMerge *merge, HalfRecord *rec)
+{
+    if (!mergeNext(merge, rec)) return HALF_END;
+    if (rec->src == rec->dst) return HALF_LOOP;
+    if (merge->have_last && rec->src == merge->last.src
+        && rec->dst == merge->last.dst) {
+        return HALF_DUP;
+    }
+    merge->last = *rec;
+    merge->have_last = 1;
+    return HALF_EDGE;
+}
+
+// Merge runs [first, first+count) into one longer run that takes their
+// place, buffering `buf_records` records of each.
+static void
+mergeRuns(ExternalBuild *xb, int first, int count, size_t buf_records)
+{
+    RunMerge merge;
+    HalfRecord *stage;
+    FILE *fp;
+    size_t k = 0;
+    int r;
+
+    fp = newRunFile(xb->path);
+    stage = tmalloc(RUN_WRITE_RECORDS * sizeof(HalfRecord));
+    openMerge(&merge, xb->runs + first, count, buf_records);
+    while (mergeNext(&merge, &stage[k])) {
+        if (++k == RUN_WRITE_RECORDS) {
+            writeRecords(fp, stage, k);
+            k = 0;
+        }
+    }
+    writeRecords(fp, stage, k);
+    closeMerge(&merge);
+    free(stage);
+
+    for (r = first; r < first + count; r++) {
+        fclose(xb->runs[r]);
+    }
+    xb->runs[first] = fp;
+    memmove(xb->runs + first+1, xb->runs + first+count,
+            (xb->num_runs - first-count) * sizeof(FILE *));
+    xb->num_runs -= count-1;
+}
+
+// Merge groups of runs into longer ones until at most EXTERNAL_MAX_RUNS
+// are left, so the final merges keep a bounded number of files open.
+static void
+mergeRounds(ExternalBuild *xb, size_t budget)
+{
+    size_t buf_records;
+    int r, group;
+
+    while (xb->num_runs > EXTERNAL_MAX_RUNS) {
+        for (r = 0; r < xb->num_runs; r++) {
+            group = xb->num_runs - r;
+            if (group > EXTERNAL_MAX_RUNS) group = EXTERNAL_MAX_RUNS;
+            buf_records = budget / 2 / group / sizeof(HalfRecord);
+            if (buf_records < EXTERNAL_MIN_BUFFER) buf_records = EXTERNAL_MIN_BUFFER;
+            mergeRuns(xb, r, group, buf_records);
+        }
+    }
+}
+
+void
+buildSnapshotExternal(InputArgs *args, size_t budget)
+{   // build the snapshot of args->infile at args->outfile out of core
+    ExternalBuild xb;
+    RunMerge merge;
+    HalfRecord rec;
+    SnapshotHeader hdr;
+    IdMap map;
+    SparseUGraph view;
+    node_t u, n = 0, cap_n = 1024, declared_n, *ids;
+    edge_t num_input, m = 0, num_loops = 0, num_dups = 0, slot, *index;
+    size_t buf_records;
+    int64_t size;
+    char *data;
+    int kind, fd, r;
+
+    if (budget < EXTERNAL_MIN_BUDGET) budget = EXTERNAL_MIN_BUDGET;
+
+    // parse the input into sorted runs of half-edges
+    memset(&xb, 0, sizeof(xb));
+    xb.path = args->outfile;
+    xb.cap = (edge_t)(budget / EXTERNAL_EDGE_BYTES);
+    if (xb.cap > MAX_EDGES) xb.cap = MAX_EDGES;
+    xb.nodes[ICOL] = tmalloc(xb.cap * sizeof(node_t));
+    xb.nodes[JCOL] = tmalloc(xb.cap * sizeof(node_t));
+    xb.src = tmalloc(xb.cap*2 * sizeof(node_t));
+    xb.dst = tmalloc(xb.cap*2 * sizeof(node_t));
+    num_input = spillInput(&xb, args->infile, args->headerless, &declared_n);
+    free(xb.nodes[ICOL]);
+    free(xb.nodes[JCOL]);
+    free(xb.src);
+    free(xb.dst);
+    if (!args->headerless) {
+        printf("reading: %" PRInode " nodes, %" PRIedge " edges\n",
+               declared_n, num_input);
+    }
+    printf("external: %" PRIedge " sorted runs of up to %" PRIedge " edges\n",
+           (num_input + xb.cap-1) / xb.cap, xb.cap);
+    mergeRounds(&xb, budget);
+    buf_records = budget / 2 / (xb.num_runs + 1) / sizeof(HalfRecord);
+    if (buf_records < EXTERNAL_MIN_BUFFER) buf_records = EXTERNAL_MIN_BUFFER;
+
+    // first merge: collect the node ids and degrees
+    ids = tmalloc(cap_n * sizeof(node_t));
+    index = tcalloc(cap_n+1, sizeof(edge_t));
+    openMerge(&merge, xb.runs, xb.num_runs, buf_records);
+    while ((kind = nextHalfEdge(&merge, &rec)) != HALF_END) {
+        if (n == 0 || rec.src != ids[n-1]) {
+            if (n == cap_n) {
+                cap_n *= 2;
+                ids = trealloc(ids, cap_n * sizeof(node_t));
+                index = trealloc(index, (cap_n+1) * sizeof(edge_t));
+            }
+            if (n == NODE_MAX) {
+                fprintf(stderr, "too many distinct node ids for node_t; "
+                        "rebuild with NODES64=1\n");
+                error(BAD_INPUT);
+            }
+            ids[n++] = rec.src;
+            index[n] = 0;
+        }
+        if (kind == HALF_LOOP) {
+            num_loops++;
+        } else if (kind == HALF_DUP) {
+            if (rec.src < rec.dst) num_dups++;
+        } else {
+            index[n]++;
+            m++;
+        }
+    }
+    closeMerge(&merge);
+    m /= 2;
+
+    if (args->headerless) {
+        printf("discovered: %" PRInode " nodes, %" PRIedge " edges\n", n, num_input);
+    } else if (n != declared_n) {
+        fprintf(stderr, "%s: header declares %" PRInode " nodes, but the file "
+                "has %" PRInode "\n", args->infile, declared_n, n);
+        error(BAD_INPUT);
+    }
+    if (num_loops > 0 || num_dups > 0) {
+        printf("canonical: %" PRIedge " edges (dropped %" PRIedge
+               " self-loops, %" PRIedge " duplicates)\n", m, num_loops, num_dups);
+    }
+
+    // map the output at its final size and fill in the node sections
+    size = layoutSnapshot(&hdr, n, m);
+    fd = open(args->outfile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        fprintf(stderr, "unable to open snapshot file: %s", args->outfile);
+        error(BAD_FP);
+    }
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "unable to map snapshot file: %s", args->outfile);
+        error(BAD_FP);
+    }
+    memcpy(data, &hdr, sizeof(hdr));
+    memcpy(data + hdr.offset[SNAP_ID], ids, n * sizeof(node_t));
+    for (u = 0; u < n; u++) {
+        index[u+1] += index[u];
+    }
+    memcpy(data + hdr.offset[SNAP_INDEX], index, (n+1) * sizeof(edge_t));
+    free(index);
+    memset(&view, 0, sizeof(view));
+    view.n = n;
+    view.m = m;
+    view.index = (edge_t *)(data + hdr.offset[SNAP_INDEX]);
+    view.edges = (node_t *)(data + hdr.offset[SNAP_EDGES]);
+    view.lower = (edge_t *)(data + hdr.offset[SNAP_LOWER]);
+    view.lower_id = (edge_t *)(data + hdr.offset[SNAP_LOWER_ID]);
+    if (n > 0) {
+        newIdMap(&map, n, ids[0], ids[n-1]);
+        for (u = 0; u < n; u++) {
+            idMapInsert(&map, ids[u], u);
+        }
+    } else {
+        newIdMap(&map, 0, 0, 0);
+    }
+    free(ids);
+
+    // second merge: stream the rows into place; rows come out in node
+    // order and each row in neighbor order
+    slot = 0;
+    openMerge(&merge, xb.runs, xb.num_runs, buf_records);
+    while ((kind = nextHalfEdge(&merge, &rec)) != HALF_END) {
+        if (kind != HALF_EDGE) continue;
+        view.edges[slot++] = idMapLookup(&map, rec.dst);
+    }
+    closeMerge(&merge);
+    assert(slot == m*2);
+
+    // edge ids only need the finished rows
+    indexEdgeSlots(&view, args->num_threads);
+
+    if (munmap(data, size) < 0 || close(fd) < 0) {
+        fprintf(stderr, "unable to write snapshot file: %s", args->outfile);
+        error(BAD_FP);
+    }
+    for (r = 0; r < xb.num_runs; r++) {
+        fclose(xb.runs[r]);
+    }
+    free(xb.runs);
+    freeIdMap(&map);
+}
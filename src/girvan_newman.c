@@ -0,0 +1,207 @@
+#include "graph.h"
+
+
+// Reapply the cuts logged in a checkpoint, iteration by iteration so that
+// an attached dendrogram sees the same splits as the original run.
+static void replayCuts(SparseUGraph *graph, Checkpoint *ckpt, Dendrogram *dendro)
+{
+    Vector cut;
+    edge_t i = 0;
+    int iteration;
+
+    newVector(&cut);
+    while (i < ckpt->cuts.size) {
+        iteration = ckpt->cuts.data[i+2];
+        cut.size = 0;
+        for (; i < ckpt->cuts.size && ckpt->cuts.data[i+2] == iteration; i += 3) {
+            cutEdge(graph, ckpt->cuts.data[i], ckpt->cuts.data[i+1], iteration);
+            vectorAppend(&cut, ckpt->cuts.data[i]);
+            vectorAppend(&cut, ckpt->cuts.data[i+1]);
+        }
+        if (dendro != NULL) updateDendrogram(dendro, graph, &cut, iteration);
+    }
+    freeVector(&cut);
+}
+
+// Use the Girvan Newman (2004) algorithm to divisely
+// cluster the graph into k partitions.
+node_t girvanNewman(SparseUGraph *graph, node_t k, float sample_rate, Vector **comms,
+                    Dendrogram *dendro, Checkpoint *ckpt)
+{
+    Vector largest;         // edges with highest betweenness
+    edge_t edges_cut=0;     // num edges cut so far
+    int iteration=1;        // which iteration the algorithm is on
+    node_t src, dest;
+    edge_t i;
+    node_t num_comms=0;
+    edge_t checkpoint=k;
+
+    assert(graph != NULL);
+    if (graph->m <= 0) return 0;
+
+    if (ckpt != NULL) {
+        ckpt->num_clusters = k;
+        ckpt->sample_rate = sample_rate;
+        if (ckpt->iteration > 1) {  // resumed
+            replayCuts(graph, ckpt, dendro);
+            iteration = ckpt->iteration;
+            edges_cut = ckpt->edges_cut;
+            checkpoint = ckpt->label_at;
+            printf("resumed at iteration %d; edges cut so far: %" PRIedge "\n",
+                   iteration, edges_cut);
+        }
+    }
+
+    while (num_comms < k && edges_cut < graph->m) {
+        printf("running iteration %d; edges cut so far: %" PRIedge "\n",
+               iteration, edges_cut);
+
+        // what the last iteration allocated for itself goes all at once
+        arenaReset(&graph->scratch);
+
+        // Calculate degree, then sample the nodes
+        calculateDegreeAndSort(graph);
+        sampleNodes(graph, sample_rate);
+        if (graph->n_s <= 0) {
+            printf("0 nodes are sampled with a sample rate of %f\n", sample_rate);
+            exit(INVALID_SAMPLE_SIZE);
+        }
+
+        // calculate edge betweenness and cut edge(s) with highest value(s)
+        calculateEdgeBetweenness(graph, &largest);
+        if (largest.size == 0) {
+            // the sample has no live edge left, so no later one would either
+            printf("no edges left to cut from the sample; stopping\n");
+            freeVector(&largest);
+            num_comms = labelCommunities(graph, comms);
+            break;
+        }
+        for (i = 0; i < largest.size; i++) {
+            src = largest.data[i++];
+            dest = largest.data[i];
+            cutEdge(graph, src, dest, iteration);
+        }
+        edges_cut += largest.size / 2;
+        if (dendro != NULL) updateDendrogram(dendro, graph, &largest, iteration);
+        if (ckpt != NULL) logCuts(ckpt, &largest, iteration);
+        iteration++;
+        freeVector(&largest);
+        // printSparseUGraph(graph, graph->n);
+
+        // check number of communities; also once nothing is left to cut
+        if (edges_cut >= checkpoint || edges_cut >= graph->m) {
+            num_comms = labelCommunities(graph, comms);
+            // reset if not done
+            if (num_comms < k && edges_cut < graph->m) {
+                for (i = num_comms-1; i >= 0; i--) {
+                    freeVector(&(*comms)[i]);
+                }
+                free(*comms);
+                checkpoint += (k - num_comms);  // set next checkpoint
+                printf("communities found so far: %" PRInode "\n", num_comms);
+            }
+        }
+
+        // save the state the next iteration starts from
+        if (ckpt != NULL && num_comms < k && edges_cut < graph->m
+            && checkpointDue(ckpt)) {
+            ckpt->iteration = iteration;
+            ckpt->edges_cut = edges_cut;
+            ckpt->label_at = checkpoint;
+            if (writeCheckpoint(ckpt, graph) == 0) {
+                printf("checkpoint written before iteration %d\n", iteration);
+            }
+        }
+    }
+    printf("completed %d iterations; total edges cut: %" PRIedge "\n",
+           iteration-1, edges_cut);
+    printf("total communities found: %" PRInode "\n", num_comms);
+    return num_comms;
+}
+
+// Cut an edge from the graph: its slots leave the live prefixes of both
+// rows, marked with the negative of the iteration number in which it was
+// cut; packed rows cannot be reordered, so there the slots are set in the
+// dead bitset.
+void cutEdge(SparseUGraph *graph, node_t src, node_t dest, int iteration)
+{
+    edge_t i;
+    node_t nbr;
+    PackedAdj *adj = &graph->packed;
+    const uint8_t *p;
+
+    if (graph->live == NULL) newLiveRows(graph);
+    if (adj->bytes != NULL) {
+        p = adj->bytes + adj->start[src];
+        nbr = src;
+        for (i = graph->index[src]; i < graph->index[src+1]; i++) {
+            p = unpackSlot(p, &nbr);
+            if (nbr == dest && !slotIsDead(adj, i)) {
+                markSlotDead(adj, i);
+                graph->live[src]--;
+            }
+        }
+        p = adj->bytes + adj->start[dest];
+        nbr = dest;
+        for (i = graph->index[dest]; i < graph->index[dest+1]; i++) {
+            p = unpackSlot(p, &nbr);
+            if (nbr == src && !slotIsDead(adj, i)) {
+                markSlotDead(adj, i);
+                graph->live[dest]--;
+            }
+        }
+        return;
+    }
+
+    cutSlot(graph, src, dest, iteration);
+    cutSlot(graph, dest, src, iteration);
+}
+
+// Build up the communities from the divided graph
+// using a union-find data structure
+node_t labelCommunities(SparseUGraph *graph, Vector **comms)
+{
+    assert(graph != NULL);
+    node_t i, j, root;
+    node_t k;
+    node_t *roots, *node_ids;
+    UnionFind *uf = uf_create(graph->n);
+
+    // build disjoint sets from graph, ignoring edges that have been cut
+    unionLiveEdges(graph, uf);
+
+    // find root of each node
+    roots = arenaAlloc(&graph->scratch, graph->n * sizeof(node_t));
+    for (i = 0; i < graph->n; i++) {
+        roots[i] = uf_root(uf, i);
+    }
+
+    // assign community ids (naive approach)
+    node_ids = arenaAlloc(&graph->scratch, graph->n * sizeof(node_t));
+    for (i = 0; i < graph->n; i++) {
+        node_ids[i] = i;
+    }
+
+    // sort in tandem, so we have ascending roots
+    radixSortKeysIn(roots, node_ids, NULL, graph->n, &graph->scratch);
+
+    // get number of communities: one per distinct root
+    k = (graph->n > 0) ? 1 : 0;
+    for (i = 1; i < graph->n; i++) {
+        if (roots[i] != roots[i-1]) k++;
+    }
+
+    // now accumulate all community members
+    j = 0;
+    *comms = tcalloc(k, sizeof(Vector));
+    for (i = 0; i < k; i++) {
+        newVector(&(*comms)[i]);
+        root = roots[j];
+        vectorAppend(&(*comms)[i], node_ids[j++]);
+        while (j < graph->n && roots[j] == root) {
+            vectorAppend(&(*comms)[i], node_ids[j++]);
+        }
+    }
+    uf_destroy(uf);
+    return k;
+}
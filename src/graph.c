@@ -1,249 +1,712 @@
 #include "graph.h"
 
-#define EID_SIZE    50
+edge_t
+findEdgeId(SparseUGraph *graph, node_t i, node_t j)
+{   // look up the id of the edge (i, j) by scanning the row of i;
+    // traversals should take `edgeIdAt` of the slot they visit instead
+    edge_t idx;
+    for (idx = graph->index[i]; idx < graph->index[i+1]; idx++) {
+        if (graph->edges[idx] == j) return edgeIdAt(graph, i, idx);
+    }
+    return -1;
+}
+
+// rows at most this long are sorted by insertion
+#define SHORT_ROW   32
+
+static int
+compareNodes(const void *a, const void *b)
+{
+    node_t x = *(const node_t *)a, y = *(const node_t *)b;
+    return (x > y) - (x < y);
+}
 
+// Sort slots [start, end) of a neighbor array, unless they already are.
+// Rows scattered from a sorted edge list (as SNAP files are) never need it.
 void
-addEdgeIdToMap(SparseUGraph *graph, int i, int j, int id)
+sortRow(node_t *edges, edge_t start, edge_t end)
+{
+    node_t nbr;
+    edge_t i, j;
+
+    for (i = start+1; i < end; i++) {
+        if (edges[i-1] > edges[i]) break;
+    }
+    if (i >= end) return;  // already in order
+
+    if (end - start <= SHORT_ROW) {
+        for (i = start+1; i < end; i++) {
+            nbr = edges[i];
+            for (j = i; j > start && edges[j-1] > nbr; j--) {
+                edges[j] = edges[j-1];
+            }
+            edges[j] = nbr;
+        }
+        return;
+    }
+    qsort(edges + start, end - start, sizeof(node_t), compareNodes);
+}
+
+// first slot in [start, end) of a sorted row whose neighbor is not below `u`
+static edge_t
+lowerBound(node_t *edges, edge_t start, edge_t end, node_t u)
 {
-    ENTRY e, *ep;
-    char edge_id_str[EID_SIZE];
+    edge_t mid;
 
-    if (i < j) sprintf(edge_id_str, "%d %d", i, j);
-    else sprintf(edge_id_str, "%d %d", j, i);
+    while (start < end) {
+        mid = start + (end - start) / 2;
+        if (edges[mid] < u) start = mid+1;
+        else end = mid;
+    }
+    return start;
+}
+
+// Set up `build` to split `length` items of work into slices of at least
+// CSR_MIN_SLICE, on up to `num_threads` threads.
+static void
+csrInit(CsrBuild *build, SparseUGraph *graph, edge_t length, int num_threads)
+{
+    int t;
+
+    // only split work large enough to repay the thread start-up
+    if (num_threads > CSR_MAX_THREADS) num_threads = CSR_MAX_THREADS;
+    if (num_threads > length / CSR_MIN_SLICE) {
+        num_threads = (int)(length / CSR_MIN_SLICE);
+    }
+    if (num_threads < 1) num_threads = 1;
+    memset(build, 0, sizeof(CsrBuild));
+    build->num_slices = num_threads;
+    for (t = 0; t < num_threads; t++) {
+        build->slices[t].build = build;
+    }
+    build->graph = graph;
+}
 
-    e.key = tcalloc(EID_SIZE, sizeof(char));
-    strncpy(e.key, edge_id_str, strlen(edge_id_str));
-    e.data = tcalloc(1, sizeof(int));
-    *(int *)e.data = id;
+// run `fn` on every slice, on its own thread when there is more than one
+static void
+csrRun(CsrBuild *build, void *(*fn)(void *))
+{
+    pthread_t threads[CSR_MAX_THREADS];
+    int t;
 
-    hsearch_r(e, FIND, &ep, &graph->edge_idmap);
-    if (ep != NULL) { // value already present in hash table
-        free(e.key);
-        free(e.data);
+    if (build->num_slices == 1) {
+        fn(&build->slices[0]);
         return;
     }
+    for (t = 0; t < build->num_slices; t++) {
+        pthread_create(&threads[t], NULL, fn, &build->slices[t]);
+    }
+    for (t = 0; t < build->num_slices; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+// Give every slice an equal share of the input edges, if any, and of the
+// nodes: by count, or if `offsets` is given, by the slots of their rows.
+static void
+csrPartition(CsrBuild *build, edge_t *offsets)
+{
+    CsrSlice *slice;
+    node_t n = build->graph->n, lo, hi, mid;
+    edge_t length = (build->elist != NULL) ? build->elist->length : 0;
+    int64_t target;
+    int t;
+
+    for (t = 0; t < build->num_slices; t++) {
+        slice = &build->slices[t];
+        slice->start = (edge_t)((int64_t)length * t / build->num_slices);
+        slice->end = (edge_t)((int64_t)length * (t+1) / build->num_slices);
+        if (offsets == NULL) {
+            slice->first = (node_t)((int64_t)n * t / build->num_slices);
+        } else {  // first row starting at or after this share of the slots
+            target = (int64_t)offsets[n] * t / build->num_slices;
+            lo = 0;
+            hi = n;
+            while (lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if (offsets[mid] < target) lo = mid+1;
+                else hi = mid;
+            }
+            slice->first = lo;
+        }
+        if (t > 0) build->slices[t-1].last = slice->first;
+    }
+    build->slices[build->num_slices-1].last = n;
+}
+
+// remap one slice of edges to contiguous ids, orient them low -> high,
+// mark self-loops with a negative low end and count the upper rows
+static void *
+csrOrient(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    CsrBuild *build = slice->build;
+    EdgeList *elist = build->elist;
+    IdMap *map = &build->graph->idmap;
+    node_t u, v, w;
+    edge_t e;
+
+    slice->count = 0;
+    for (e = slice->start; e < slice->end; e++) {
+        u = lookupNodeId(map, elist->nodes[ICOL][e]);
+        v = lookupNodeId(map, elist->nodes[JCOL][e]);
+        if (u == v) {
+            slice->count++;
+            u = -1;
+        } else if (u > v) {
+            w = u;
+            u = v;
+            v = w;
+        }
+        elist->nodes[ICOL][e] = u;
+        elist->nodes[JCOL][e] = v;
+        if (u >= 0) __atomic_fetch_add(&build->upper[u+1], 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// remap one slice of streamed edges, oriented already, from provisional
+// to contiguous ids
+static void *
+csrRelabel(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    CsrBuild *build = slice->build;
+    EdgeList *elist = build->elist;
+    node_t *relabel = build->relabel;
+    edge_t e;
+
+    for (e = slice->start; e < slice->end; e++) {
+        if (elist->nodes[ICOL][e] < 0) continue;  // self-loop
+        elist->nodes[ICOL][e] = relabel[elist->nodes[ICOL][e]];
+        elist->nodes[JCOL][e] = relabel[elist->nodes[JCOL][e]];
+    }
+    return NULL;
+}
+
+// prefix sums, first pass: sum up this slice's share of the counts
+static void *
+csrSumCounts(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    edge_t *a = slice->build->prefix;
+    node_t u;
+
+    slice->count = 0;
+    for (u = slice->first; u < slice->last; u++) {
+        slice->count += a[u+1];
+    }
+    return NULL;
+}
+
+// prefix sums, second pass: accumulate the share onto the earlier ones
+static void *
+csrAddCounts(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    edge_t *a = slice->build->prefix, sum = slice->base;
+    node_t u;
+
+    for (u = slice->first; u < slice->last; u++) {
+        sum += a[u+1];
+        a[u+1] = sum;
+    }
+    return NULL;
+}
+
+// turn the counts a[1..n] into row offsets, a[0] being 0
+static void
+csrPrefixSum(CsrBuild *build, edge_t *a)
+{
+    edge_t base = 0;
+    int t;
+
+    build->prefix = a;
+    csrPartition(build, NULL);
+    csrRun(build, csrSumCounts);
+    for (t = 0; t < build->num_slices; t++) {
+        build->slices[t].base = base;
+        base += build->slices[t].count;
+    }
+    csrRun(build, csrAddCounts);
+}
+
+// scatter one slice of oriented edges into the upper rows
+static void *
+csrScatterUpper(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    CsrBuild *build = slice->build;
+    EdgeList *elist = build->elist;
+    edge_t e, slot;
+    node_t u;
+
+    for (e = slice->start; e < slice->end; e++) {
+        u = elist->nodes[ICOL][e];
+        if (u < 0) continue;
+        slot = __atomic_fetch_add(&build->cursor[u], 1, __ATOMIC_RELAXED);
+        build->upper_nbr[slot] = elist->nodes[JCOL][e];
+    }
+    return NULL;
+}
+
+// sort the upper rows of one slice of nodes, so that copies of an edge
+// are adjacent, and drop all but one (giving them a negative neighbor)
+static void *
+csrDedupe(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    CsrBuild *build = slice->build;
+    edge_t i;
+    node_t u;
+
+    slice->count = 0;
+    for (u = slice->first; u < slice->last; u++) {
+        sortRow(build->upper_nbr, build->upper[u], build->upper[u+1]);
+        for (i = build->upper[u]+1; i < build->upper[u+1]; i++) {
+            if (build->upper_nbr[i] == build->upper_nbr[i-1]) {
+                slice->count++;
+                build->upper_nbr[i-1] = -1;
+            }
+        }
+    }
+    return NULL;
+}
+
+// count both ends of the kept edges of one slice of upper rows
+static void *
+csrCountDegrees(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    CsrBuild *build = slice->build;
+    edge_t *index = build->graph->index, i;
+    node_t u, v;
+
+    for (u = slice->first; u < slice->last; u++) {
+        for (i = build->upper[u]; i < build->upper[u+1]; i++) {
+            v = build->upper_nbr[i];
+            if (v < 0) continue;
+            __atomic_fetch_add(&index[u+1], 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&index[v+1], 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
 
-    hsearch_r(e, ENTER, &ep, &graph->edge_idmap);
-    if (ep == NULL) {
-        fprintf(stderr, "edge id map hash entry failed for (%d %d)\n", i, j);
-        error(EXIT_FAILURE);
+// scatter both half-edges of the kept edges of one slice of upper rows
+static void *
+csrScatter(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    CsrBuild *build = slice->build;
+    node_t *edges = build->graph->edges, u, v;
+    edge_t i, slot;
+
+    for (u = slice->first; u < slice->last; u++) {
+        for (i = build->upper[u]; i < build->upper[u+1]; i++) {
+            v = build->upper_nbr[i];
+            if (v < 0) continue;
+            slot = __atomic_fetch_add(&build->cursor[u], 1, __ATOMIC_RELAXED);
+            edges[slot] = v;
+            slot = __atomic_fetch_add(&build->cursor[v], 1, __ATOMIC_RELAXED);
+            edges[slot] = u;
+        }
     }
-    addIdmapEntry(&graph->eidmap_store, ep);
+    return NULL;
 }
 
-int
-findEdgeId(SparseUGraph *graph, int i, int j)
-{   // look up the id of the edge (i, j)
-    ENTRY e, *ep;
-    char edge_id_str[EID_SIZE];
+// sort the finished rows of one slice of nodes
+static void *
+csrSortRows(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    SparseUGraph *graph = slice->build->graph;
+    node_t u;
+
+    for (u = slice->first; u < slice->last; u++) {
+        sortRow(graph->edges, graph->index[u], graph->index[u+1]);
+    }
+    return NULL;
+}
 
-    if (i < j) sprintf(edge_id_str, "%d %d", i, j);
-    else sprintf(edge_id_str, "%d %d", j, i);
+// count the lower halves of one slice of sorted rows
+static void *
+csrCountLower(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    SparseUGraph *graph = slice->build->graph;
+    node_t u;
 
-    e.key = tcalloc(EID_SIZE, sizeof(char));
-    strncpy(e.key, edge_id_str, strlen(edge_id_str));
+    for (u = slice->first; u < slice->last; u++) {
+        graph->lower[u+1] = lowerBound(graph->edges, graph->index[u],
+                                       graph->index[u+1], u) - graph->index[u];
+    }
+    return NULL;
+}
 
-    hsearch_r(e, FIND, &ep, &graph->edge_idmap);
-    if (ep == NULL) {
-        fprintf(stderr, "edge id map hash lookup failed for (%d %d)\n", i, j);
-        error(EXIT_FAILURE);
+// Find the id of every lower half (u, v) of one slice of rows: the upper
+// half (v, u) is found by binary search in the upper part of row v.
+static void *
+csrLowerIds(void *arg)
+{
+    CsrSlice *slice = (CsrSlice *)arg;
+    SparseUGraph *graph = slice->build->graph;
+    edge_t i, j, split;
+    node_t u, v;
+
+    for (u = slice->first; u < slice->last; u++) {
+        split = graph->index[u] + lowerDegree(graph, u);
+        for (i = graph->index[u]; i < split; i++) {
+            v = graph->edges[i];
+            j = lowerBound(graph->edges, graph->index[v] + lowerDegree(graph, v),
+                           graph->index[v+1], u);
+            assert(j < graph->index[v+1] && graph->edges[j] == u);
+            graph->lower_id[graph->lower[u] + i - graph->index[u]] = j - graph->lower[v+1];
+        }
     }
-    free(e.key);
-    return *((int *)ep->data);
+    return NULL;
 }
 
-// Compress edges from edge list into a compressed row storage (CRS) format
 void
-rowCompressEdges(EdgeList *elist_i, SparseUGraph *graph)
+indexEdgeSlots(SparseUGraph *graph, int num_threads)
+{   // fill in `lower` and `lower_id` from the sorted rows of `graph`
+    CsrBuild build;
+
+    csrInit(&build, graph, graph->m*2, num_threads);
+    graph->lower[0] = 0;
+    csrPartition(&build, graph->index);
+    csrRun(&build, csrCountLower);
+    csrPrefixSum(&build, graph->lower);
+    assert(graph->lower[graph->n] == graph->m);
+    csrPartition(&build, graph->index);
+    csrRun(&build, csrLowerIds);
+}
+
+// Lay out the upper rows counted in `build->upper`, drop the repeated
+// edges and build the rows of the graph from the rest; see
+// `rowCompressEdges`.
+static void
+csrBuildRows(CsrBuild *build, edge_t *num_dups, int num_threads)
 {
-    EdgeList elist_j;
-    int edge_idx=0, id_idx=0, index_idx=0;
-    int cur_id, prev_id = -1;
-    int i_end, j_end, i_idx=0, j_idx=0, eid;
-    int i_orig, j_orig, i_end_orig, j_end_orig;
+    SparseUGraph *graph = build->graph;
+    int t;
+
+    build->cursor = tmalloc(graph->n * sizeof(edge_t));
+    csrPrefixSum(build, build->upper);
+
+    // scatter v into the upper row of u, then sort each row and drop
+    // the repeated copies of every edge
+    build->upper_nbr = tmalloc(build->upper[graph->n] * sizeof(node_t));
+    memcpy(build->cursor, build->upper, graph->n * sizeof(edge_t));
+    csrPartition(build, NULL);
+    csrRun(build, csrScatterUpper);
+    csrPartition(build, build->upper);
+    csrRun(build, csrDedupe);
+    *num_dups = 0;
+    for (t = 0; t < build->num_slices; t++) {
+        *num_dups += build->slices[t].count;
+    }
+    graph->m = build->upper[graph->n] - *num_dups;
 
     // Allocate space for edge and node storage.
     // Note that the `mapNodeIds` function allocates space for the id array.
-    graph->index = tcalloc(graph->n+1, sizeof(int));
-    graph->edges = tcalloc(graph->m*2, sizeof(int));
-    graph->edge_id = tcalloc(graph->m*2, sizeof(int));
-
-    // Now copy the edgelist and sort the copy on the j column
-    copyEdgeList(elist_i, &elist_j);
-    sortEdges(&elist_j, JCOL);
-
-    // debug
-    // printf("j direction edgelist:\n");
-    // printEdgeList(&elist_j, graph->m);
-
-    // For each node in the id array, move through the 2 edge
-    // lists to build up the index and edges arrays.
-    // Note that these ids must be converted to the contiguous ids
-    // using the node id map built in `mapNodeIds`, which is available
-    // globally via the <search.h> header functions.
-    cur_id = graph->id[id_idx];
-    while (id_idx <= graph->n+1) {
-        if (prev_id != cur_id) {
-            // move up in index array
-            graph->index[index_idx++] = edge_idx;
-            prev_id = cur_id;
-        }
+    graph->index = tcalloc(graph->n+1, sizeof(edge_t));
+    graph->edges = tmalloc(graph->m*2 * sizeof(node_t));
+    graph->lower = tmalloc((graph->n+1) * sizeof(edge_t));
+    graph->lower_id = tmalloc(graph->m * sizeof(edge_t));
+
+    // both ends of every kept edge count towards the degrees, which the
+    // prefix sum turns into row offsets
+    csrRun(build, csrCountDegrees);
+    csrPrefixSum(build, graph->index);
+
+    // scatter (u, v) into the row of u and (v, u) into the row of v, then
+    // put every row in order
+    memcpy(build->cursor, graph->index, graph->n * sizeof(edge_t));
+    csrPartition(build, build->upper);
+    csrRun(build, csrScatter);
+    csrPartition(build, graph->index);
+    csrRun(build, csrSortRows);
+
+    free(build->cursor);
+    free(build->upper_nbr);
+    free(build->upper);
+    indexEdgeSlots(graph, num_threads);
+}
 
-        // get the original ids, then convert with mapping
-        i_orig = elist_i->nodes[ICOL][i_idx];
-        j_orig = elist_j.nodes[JCOL][j_idx];
-
-        // add the appropriate edge
-        if (i_orig == cur_id) {
-            i_end_orig = elist_i->nodes[JCOL][i_idx];
-            if (j_orig == cur_id) {
-                // add whichever is smaller
-                j_end_orig = elist_j.nodes[ICOL][j_idx];
-                if (i_end_orig < j_end_orig) {  // i endpoint is smaller
-                    i_end = lookupNodeId(i_end_orig);
-                    graph->edges[edge_idx] = i_end;
-                    eid = elist_i->id[i_idx++];
-                    graph->edge_id[edge_idx++] = eid;
-                    addEdgeIdToMap(graph, index_idx-1, i_end, eid);
-                } else {  // j endpoint is smaller
-                    j_end = lookupNodeId(j_end_orig);
-                    graph->edges[edge_idx] = j_end;
-                    eid = elist_j.id[j_idx++];
-                    graph->edge_id[edge_idx++] = eid;
-                    addEdgeIdToMap(graph, index_idx-1, j_end, eid);
-                }
-            } else {
-                // add i value
-                i_end = lookupNodeId(i_end_orig);
-                graph->edges[edge_idx] = i_end;
-                eid = elist_i->id[i_idx++];
-                graph->edge_id[edge_idx++] = eid;
-                addEdgeIdToMap(graph, index_idx-1, i_end, eid);
-            }
-        } else if (j_orig == cur_id) {  // add j value
-            j_end = lookupNodeId(elist_j.nodes[ICOL][j_idx]);
-            graph->edges[edge_idx] = j_end;
-            eid = elist_j.id[j_idx++];
-            graph->edge_id[edge_idx++] = eid;
-            addEdgeIdToMap(graph, index_idx-1, j_end, eid);
-        } else {  // done with this node
-            cur_id = graph->id[id_idx++];
-        }
+// Compress edges from edge list into a compressed row storage (CRS) format,
+// canonicalizing them on the way. The endpoints are remapped to contiguous
+// ids once, in place, and each edge is oriented low -> high; self-loops are
+// dropped there. The oriented edges are counting-sorted into upper rows
+// keyed by their low endpoint and each row sorted, so that a repeated
+// (u, v) -- in either direction in the input -- lands next to another copy
+// and is dropped. Both halves of the survivors are scattered into
+// `index`/`edges`, every row is sorted by neighbor, and the edge ids are
+// laid out by `indexEdgeSlots`. `graph->m` is updated to the canonical
+// edge count.
+//
+// Every phase runs on up to `num_threads` threads, over slices of the
+// input edges or of the nodes (balanced by row lengths). Counts are
+// accumulated with atomic adds, prefix sums go slice by slice, and
+// scatters claim their slots with atomic cursors; the rows are sorted
+// afterwards, so the result does not depend on the number of threads.
+// On one thread the upper rows come out in order, the scatter fills every
+// row in ascending neighbor order and the sorts only check.
+void
+rowCompressEdges(EdgeList *elist, SparseUGraph *graph, edge_t *num_loops,
+                 edge_t *num_dups, int num_threads)
+{
+    CsrBuild build;
+    int t;
+
+    csrInit(&build, graph, elist->length, num_threads);
+    build.elist = elist;
+    build.upper = tcalloc(graph->n+1, sizeof(edge_t));
+
+    // convert to contiguous ids using the node id map built in
+    // `mapNodeIds`, orient, and count the upper rows
+    csrPartition(&build, NULL);
+    csrRun(&build, csrOrient);
+    *num_loops = 0;
+    for (t = 0; t < build.num_slices; t++) {
+        *num_loops += build.slices[t].count;
+    }
+    csrBuildRows(&build, num_dups, num_threads);
+}
+
+void
+rowCompressStream(StreamedEdges *stream, SparseUGraph *graph, edge_t *num_dups,
+                  int num_threads)
+{   // finish the CSR of an edge list oriented and counted while streaming
+    CsrBuild build;
+    node_t u;
+
+    csrInit(&build, graph, stream->elist.length, num_threads);
+    build.elist = &stream->elist;
+    build.relabel = stream->relabel;
+    build.upper = tcalloc(graph->n+1, sizeof(edge_t));
+    for (u = 0; u < graph->n; u++) {
+        build.upper[stream->relabel[u]+1] = stream->upper[u];
     }
-    freeEdgeList(&elist_j);
+    csrPartition(&build, NULL);
+    csrRun(&build, csrRelabel);
+    csrBuildRows(&build, num_dups, num_threads);
+}
+
 
-    // debug
-    assert(id_idx-1 == graph->n+1);
+// Read a graph from a pipe. The ids are interned and the upper rows
+// counted as the blocks arrive, so once the writer is done only the
+// distinct ids are left to sort before the CSR build.
+static void
+readStreamedSparseUGraph(InputArgs *args, SparseUGraph *graph)
+{
+    StreamedEdges stream;
+    edge_t num_dups;
+
+    newStreamedEdges(&stream);
+    readEdgeStream(args->infile, &stream, &graph->n, &graph->m, args->headerless);
+    if (!args->headerless) {
+        printf("reading: %" PRInode " nodes, %" PRIedge " edges\n",
+               graph->n, graph->m);
+    } else {
+        graph->n = stream.num_ids;
+        printf("discovered: %" PRInode " nodes, %" PRIedge " edges\n",
+               graph->n, graph->m);
+    }
+    assert(graph->n == stream.num_ids);
+
+    relabelStreamedIds(&stream, &graph->id);
+    rowCompressStream(&stream, graph, &num_dups, args->num_threads);
+    if (stream.num_loops > 0 || num_dups > 0) {
+        printf("canonical: %" PRIedge " edges (dropped %" PRIedge
+               " self-loops, %" PRIedge " duplicates)\n",
+               graph->m, stream.num_loops, num_dups);
+    }
+    freeStreamedEdges(&stream);
 }
 
 void
 readSparseUGraph(InputArgs *args, SparseUGraph *graph)
 {
-    FILE *fpin;
     EdgeList elist;
-    int i, num_ids, edge_idx=0;
-
-    // read the first line, which contains #nodes #edges
-    fpin = fopen(args->infile, "r");
-    if (fpin == NULL) {
-        fprintf(stderr, "Unable to open graph edgelist: %s", args->infile);
-        error(BAD_FP);
-    }
-    fscanf(fpin, "%d %d", &graph->n, &graph->m);
-    printf("reading: %d nodes, %d edges\n", graph->n, graph->m);
-
-    // allocate a new edgelist to work with while converting to CRS
-    newEdgeList(&elist, graph->m);
-
-    // now read in the edgelist, one at a time
-    while (!feof(fpin)) {
-        fscanf(fpin, "%d %d",
-               &elist.nodes[ICOL][edge_idx],
-               &elist.nodes[JCOL][edge_idx]);
-        edge_idx++;
-    }
-    assert(graph->m == --edge_idx);
-    fclose(fpin);
-    // printf("# edges read: %d\n", --edge_idx);
-    // printEdgeList(&elist, edge_idx);
-
-    // get listing of all unique node ids
-    mapNodeIds(&elist, &graph->id, &num_ids, &graph->idmap);
-    assert(graph->n == num_ids);
-
-    // compress edgelist rows to construct index and edge list
-    memset(&graph->edge_idmap, 0, sizeof(graph->edge_idmap));
-    hcreate_r(graph->m + graph->m*0.25, &graph->edge_idmap);
-    newIdmapStorage(&graph->eidmap_store, graph->m);
-    rowCompressEdges(&elist, graph);
-    freeEdgeList(&elist);
+    node_t num_ids;
+    edge_t num_loops, num_dups;
+
+    // a snapshot already holds the CSR arrays; just map them
+    memset(&graph->snapshot, 0, sizeof(graph->snapshot));
+    memset(&graph->id_file, 0, sizeof(graph->id_file));
+    memset(&graph->packed, 0, sizeof(graph->packed));
+    memset(&graph->idmap, 0, sizeof(graph->idmap));
+    newArena(&graph->arena, ARENA_BLOCK_SIZE);
+    newArena(&graph->scratch, ARENA_BLOCK_SIZE);
+    if (isStreamInput(args->infile)) {
+        readStreamedSparseUGraph(args, graph);
+    } else if (isSnapshotFile(args->infile)) {
+        loadSnapshot(args->infile, graph);
+        printf("loaded snapshot: %" PRInode " nodes, %" PRIedge " edges\n",
+               graph->n, graph->m);
+    } else {
+        // map the file and scan the #nodes #edges header and all edges
+        // into a new edgelist to work with while converting to CRS
+        readEdgeListFile(args->infile, &elist, &graph->n, &graph->m,
+                         args->num_threads, args->headerless);
+        if (!args->headerless) {
+            printf("reading: %" PRInode " nodes, %" PRIedge " edges\n",
+                   graph->n, graph->m);
+        }
+        // printEdgeList(&elist, graph->m);
+
+        // get listing of all unique node ids; without a header this is
+        // where the node count is discovered
+        mapNodeIds(&elist, &graph->id, &num_ids, &graph->idmap);
+        if (args->headerless) {
+            graph->n = num_ids;
+            printf("discovered: %" PRInode " nodes, %" PRIedge " edges\n",
+                   graph->n, graph->m);
+        }
+        assert(graph->n == num_ids);
+
+        // compress edgelist rows to construct index and edge list,
+        // dropping self-loops and repeated edges
+        rowCompressEdges(&elist, graph, &num_loops, &num_dups, args->num_threads);
+        if (num_loops > 0 || num_dups > 0) {
+            printf("canonical: %" PRIedge " edges (dropped %" PRIedge
+                   " self-loops, %" PRIedge " duplicates)\n",
+                   graph->m, num_loops, num_dups);
+        }
+        freeEdgeList(&elist);
+        freeIdMap(&graph->idmap);  // only needed while building
+    }
 
     // set remaining data to NULL or empty
-    graph->node_id = (int *)tcalloc(graph->n, sizeof(int));
-    for (i = 0; i < graph->n; i++) {
-        graph->node_id[i] = i;
-    }
+    graph->node_id = arenaAlloc(&graph->arena, graph->n * sizeof(node_t));
+    graph->id_order = NULL;
+    orderNodesById(graph);
+    graph->live = NULL;
+    graph->slot_id = NULL;
     graph->degree = NULL;
     graph->edge_bet = NULL;
     graph->sample = NULL;
-
-    // Write out the ID array; we won't be using it while processing.
-    // It can be used later to translate the output (in node indices)
-    // to the input node IDs.
-    // storeAndFreeNodeIds(graph);
 }
 
 void
 freeSparseUGraph(SparseUGraph *graph)
 {   // free all memory allocated for sparse undirected graph
-    free(graph->index);
-    free(graph->edges);
-    free(graph->edge_id);
-    free(graph->node_id);
+    if (graph->snapshot.data != NULL) {
+        // the CSR arrays (and id array) live in the snapshot mapping
+        unmapFile(&graph->snapshot);
+        graph->id = NULL;
+    } else {
+        free(graph->index);
+        free(graph->edges);
+        free(graph->lower);
+        free(graph->lower_id);
+    }
+    freeArena(&graph->arena);
+    freeArena(&graph->scratch);
+    freePackedAdj(&graph->packed);
 
     // now check for others and free as necessary
-    if (graph->id != NULL) {
-        free(graph->id);
-        freeIdmapStorage(&graph->idmap);
-        hdestroy();
+    if (graph->id_file.data != NULL) {  // mapped, not allocated
+        unmapFile(&graph->id_file);
+        graph->id = NULL;
     }
+    if (graph->id != NULL) free(graph->id);
+    freeIdMap(&graph->idmap);
     if (graph->edge_bet != NULL) free(graph->edge_bet);
-    if (graph->degree != NULL) free(graph->degree);
-    if (graph->sample != NULL) free(graph->sample);
+}
 
-    // free hashtable used for node id mapping and edge id mapping
-    freeIdmapStorage(&graph->eidmap_store);
-    hdestroy_r(&graph->edge_idmap);
+// print the counts of one arena
+static void
+printArenaStats(char *name, Arena *a)
+{
+    printf("%s: %" PRIu64 " allocations, %" PRIu64 " resets, %" PRIu64
+           " blocks, peak %.1f MB\n", name, a->allocs, a->resets, a->blocks,
+           a->peak / (1024.0 * 1024.0));
 }
 
 void
-storeAndFreeNodeIds(SparseUGraph *graph)
+printAllocStats(SparseUGraph *graph)
 {
-    assert(graph->id != NULL);
-    int i;
-    FILE *fpout;
-    char store_file[50] = "../output/node_ids.txt";
+    HeapStats heap;
 
-    fpout = fopen(store_file, "w");
-    for (i=0; i < graph->n; i++) {
-        fprintf(fpout, "%d\n", graph->id[i]);
+    getHeapStats(&heap);
+    printf("heap: %" PRIu64 " tcalloc, %" PRIu64 " tmalloc, %" PRIu64 " trealloc\n",
+           heap.tcalloc_calls, heap.tmalloc_calls, heap.trealloc_calls);
+    printArenaStats("graph arena", &graph->arena);
+    printArenaStats("iteration arena", &graph->scratch);
+}
+
+void
+newLiveRows(SparseUGraph *graph)
+{   // every slot is live; plain rows copy their slot ids before moving
+    node_t u;
+    edge_t i;
+
+    assert(graph->live == NULL);
+    graph->live = arenaAlloc(&graph->arena, graph->n * sizeof(node_t));
+    for (u = 0; u < graph->n; u++) {
+        graph->live[u] = graph->index[u+1] - graph->index[u];
+    }
+    if (graph->packed.bytes != NULL) return;
+    graph->slot_id = arenaAlloc(&graph->arena, graph->m*2 * sizeof(edge_t));
+    for (u = 0; u < graph->n; u++) {
+        for (i = graph->index[u]; i < graph->index[u+1]; i++) {
+            graph->slot_id[i] = slotEdgeId(graph, u, i);
+        }
     }
+}
+
+void
+cutSlot(SparseUGraph *graph, node_t u, node_t v, int iteration)
+{   // O(degree): the live prefix is sorted, so v is found by bisection,
+    // and the live slots after it move down one to close the gap
+    edge_t start = graph->index[u], end = start + graph->live[u], i, id;
+
+    i = lowerBound(graph->edges, start, end, v);
+    if (i == end || graph->edges[i] != v) return;
+    id = graph->slot_id[i];
+    memmove(&graph->edges[i], &graph->edges[i+1], (end-1 - i) * sizeof(node_t));
+    memmove(&graph->slot_id[i], &graph->slot_id[i+1], (end-1 - i) * sizeof(edge_t));
+    graph->edges[end-1] = -iteration;
+    graph->slot_id[end-1] = id;
+    graph->live[u]--;
+}
+
+void
+unionLiveEdges(SparseUGraph *graph, UnionFind *uf)
+{   // union the ends of every edge that has not been cut
+    PackedAdj *adj = &graph->packed;
+    const uint8_t *p;
+    node_t i, j;
+    edge_t idx, end;
 
-    fclose(fpout);
-    free(graph->id);
-    freeIdmapStorage(&graph->idmap);
-    graph->id = NULL;
-    printf("Node id array stored in %s\n", store_file);
-    hdestroy(); // remove node id hash table mapping
+    for (i = 0; i < graph->n; i++) {
+        if (adj->bytes != NULL) {
+            p = adj->bytes + adj->start[i];
+            j = i;
+            for (idx = graph->index[i]; idx < graph->index[i+1]; idx++) {
+                p = unpackSlot(p, &j);
+                if (!slotIsDead(adj, idx)) uf_union(uf, i, j);
+            }
+            continue;
+        }
+        end = graph->index[i] + liveDegree(graph, i);
+        for (idx = graph->index[i]; idx < end; idx++) {
+            uf_union(uf, i, graph->edges[idx]);
+        }
+    }
 }
 
 // print the graph, up to `num_nodes`
 void
-printSparseUGraph(SparseUGraph *graph, int num_nodes)
+printSparseUGraph(SparseUGraph *graph, node_t num_nodes)
 {
     assert(graph != NULL);
-    int i, j;
+    node_t i;
+    edge_t j;
 
+    assert(graph->packed.bytes == NULL);
     if (graph->n <= 0) return;
     num_nodes = (num_nodes > graph->n) ? graph->n : num_nodes;
 
@@ -252,12 +715,13 @@ printSparseUGraph(SparseUGraph *graph, int num_nodes)
         printArray(graph->id, graph->n);
     }
     printf("graph index:\n");
-    printArray(graph->index, graph->n+1);
+    printOffsets(graph->index, graph->n+1);
     printf("graph edgelist:\n");
 
     for (i = 0; i < num_nodes; i++) {
         for (j = graph->index[i]; j < graph->index[i+1]; j++) {
-            printf("%d: (%d, %d)\n", graph->edge_id[j], i, graph->edges[j]);
+            printf("%" PRIedge ": (%" PRInode ", %" PRInode ")\n",
+                   edgeIdAt(graph, i, j), i, graph->edges[j]);
         }
     }
 }
@@ -267,7 +731,9 @@ printSparseUGraph(SparseUGraph *graph, int num_nodes)
 void
 graphToEdgeList(SparseUGraph *graph, EdgeList *elist)
 {
-    int i, j, edge_idx=0;
+    node_t i;
+    edge_t j, edge_idx=0;
+    assert(graph->packed.bytes == NULL);
 
     // allocate space for edge list
     newEdgeList(elist, graph->m);
@@ -277,16 +743,16 @@ graphToEdgeList(SparseUGraph *graph, EdgeList *elist)
         for (j = graph->index[i]; j < graph->index[i+1]; j++) {
             elist->nodes[ICOL][edge_idx] = i;
             elist->nodes[JCOL][edge_idx] = graph->edges[j];
-            elist->id[edge_idx] = graph->edge_id[j];
+            elist->id[edge_idx] = edgeIdAt(graph, i, j);
             edge_idx++;
         }
     }
 }
 
-int findIndex(int *arr, int low, int high, int val)
+edge_t findIndex(node_t *arr, edge_t low, edge_t high, node_t val)
 {   // invariants: value > A[i] for all i < low
     //value < A[i] for all i > high
-    int mid;
+    edge_t mid;
 
     while (low <= high) {
         mid = (low + high) / 2;
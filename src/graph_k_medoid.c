@@ -37,11 +37,11 @@ void genKSeeds(SparseUGraph *graph, kMedoidInfo *k_med, DTZ *dtz_idx)
 {
     int *temp_index;
     int i, j, r;
+    unsigned int seed = (unsigned int)time(NULL);  // rand() state is process-wide
     
     k_med->seed_nodes = (int *)tcalloc(k_med->k, sizeof(int));
     temp_index = (int *)tcalloc(graph->n, sizeof(int));
     k_med->unlabeled = (int *)tcalloc((graph->n - k_med->k), sizeof(int));
-    srand(time(NULL));
 
     // fill temp array
     for(i=0; i<graph->n; i++) {
@@ -50,7 +50,7 @@ void genKSeeds(SparseUGraph *graph, kMedoidInfo *k_med, DTZ *dtz_idx)
 
     // get random unique node ids
     for(i=0; i<k_med->k; i++) {
-	r = (rand() % (graph->n));
+	r = (rand_r(&seed) % (graph->n));
 	if(temp_index[r] > -1) {
 	    k_med->seed_nodes[i] = temp_index[r];
 	    dtz_idx[r].label = temp_index[r];
@@ -77,17 +77,16 @@ void genKSeeds(SparseUGraph *graph, kMedoidInfo *k_med, DTZ *dtz_idx)
 void labelDTZidx(SparseUGraph *graph, kMedoidInfo *k_med, DTZ *dtz_idx)
 {
     int i, j, from_labeled, degree;
-
-    srand(time(NULL));
+    unsigned int seed = (unsigned int)time(NULL);
 
     while(1) {
 	// randomly select node from labeled set
-	from_labeled = k_med->seed_nodes[rand() % k_med->k];
+	from_labeled = k_med->seed_nodes[rand_r(&seed) % k_med->k];
 
 	// find degree of selected labeled node
 	degree = (graph->index[from_labeled+1] - graph->index[from_labeled]);
 
-	printArray(graph->index, graph->n+1);
+	printOffsets(graph->index, graph->n+1);
 	// randomly select a neighbor
 	//	neighbor = graph->edges[rand() % degree
 	break;
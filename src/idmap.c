@@ -0,0 +1,119 @@
+#include "graph.h"
+
+
+// Fibonacci hashing: multiply by 2^w/phi and keep the top bits
+#ifdef NODES64
+#define hashId(map, id) \
+    ((node_t)(((uint64_t)(id) * 11400714819323198485u) >> (map)->shift))
+#else
+#define hashId(map, id) \
+    ((node_t)(((uint32_t)(id) * 2654435769u) >> (map)->shift))
+#endif
+
+void
+newIdMap(IdMap *map, node_t count, node_t min_id, node_t max_id)
+{   // allocate a map for `count` ids, all in the range [min_id, max_id]
+    int bits = 1;
+    uint64_t span = (uint64_t)max_id - (uint64_t)min_id;  // range - 1
+
+    map->count = 0;
+    map->min_id = min_id;
+    map->slots = NULL;
+    map->values = NULL;
+
+    if (count > 0 && span < (uint64_t)count * IDMAP_DENSE_FACTOR) {
+        map->dense = 1;
+        map->cap = (node_t)span + 1;
+        map->shift = 0;
+        map->values = tmalloc(map->cap * sizeof(node_t));
+        memset(map->values, 0xff, map->cap * sizeof(node_t));  // all -1
+    } else {
+        // keep the load factor at or below 1/2
+        while (((node_t)1 << bits) < count*2) bits++;
+        map->dense = 0;
+        map->cap = (node_t)1 << bits;
+        map->shift = (int)sizeof(node_t)*8 - bits;
+        map->slots = tmalloc(map->cap * sizeof(IdMapSlot));
+        memset(map->slots, 0xff, map->cap * sizeof(IdMapSlot));  // all -1
+    }
+}
+
+void
+freeIdMap(IdMap *map)
+{   // free the storage owned by the map
+    free(map->slots);
+    free(map->values);
+    map->slots = NULL;
+    map->values = NULL;
+    map->cap = 0;
+    map->count = 0;
+}
+
+void
+idMapInsert(IdMap *map, node_t orig_id, node_t node_id)
+{   // add a mapping from the original node id to a contiguous one
+    node_t *value, slot;
+
+    if (map->dense) {
+        slot = orig_id - map->min_id;
+        assert(slot >= 0 && slot < map->cap);
+        value = &map->values[slot];
+    } else {
+        slot = hashId(map, orig_id);
+        while (map->slots[slot].value >= 0 && map->slots[slot].key != orig_id) {
+            slot = (slot + 1) & (map->cap - 1);
+        }
+        map->slots[slot].key = orig_id;
+        value = &map->slots[slot].value;
+    }
+    if (*value < 0) {
+        assert(map->count < map->cap);
+        map->count++;
+    }
+    *value = node_id;
+}
+
+void
+idMapReserve(IdMap *map, node_t count)
+{   // grow a hashed map until `count` ids fit at a load of at most 1/2
+    IdMapSlot *old = map->slots;
+    node_t old_cap = map->cap, s, slot;
+
+    assert(!map->dense);
+    if (count*2 <= map->cap) return;
+    while (map->cap < count*2) {
+        map->cap *= 2;
+        map->shift--;
+    }
+    map->slots = tmalloc(map->cap * sizeof(IdMapSlot));
+    memset(map->slots, 0xff, map->cap * sizeof(IdMapSlot));  // all -1
+    for (s = 0; s < old_cap; s++) {
+        if (old[s].value < 0) continue;
+        slot = hashId(map, old[s].key);
+        while (map->slots[slot].value >= 0) {
+            slot = (slot + 1) & (map->cap - 1);
+        }
+        map->slots[slot] = old[s];
+    }
+    free(old);
+}
+
+node_t
+idMapLookup(IdMap *map, node_t orig_id)
+{   // return the contiguous id mapped to `orig_id`, or -1 if it is unknown
+    uint64_t offset;
+    node_t slot;
+
+    if (map->dense) {
+        offset = (uint64_t)orig_id - (uint64_t)map->min_id;
+        if (offset >= (uint64_t)map->cap) return -1;
+        return map->values[offset];
+    }
+
+    slot = hashId(map, orig_id);
+    while (map->slots[slot].value >= 0) {
+        if (map->slots[slot].key == orig_id) return map->slots[slot].value;
+        slot = (slot + 1) & (map->cap - 1);
+    }
+    return -1;
+}
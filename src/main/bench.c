@@ -0,0 +1,290 @@
+#include "graph.h"
+
+// BFS sources per timing run
+#define BENCH_BFS_SOURCES   16
+
+double wallTime();
+double parseWithStdio(char *path, EdgeList *elist);
+double parseWithMmap(char *path, EdgeList *elist, int num_threads);
+double loadGraph(InputArgs *args);
+off_t fileSize(char *path);
+void assertSameEdges(EdgeList *a, EdgeList *b);
+double remapWithHsearch(EdgeList *elist, node_t *ids, node_t n, node_t *out);
+double remapWithIdMap(EdgeList *elist, node_t *ids, node_t n, node_t *out);
+double timeBFS(SparseUGraph *graph, node_t num_sources, uint64_t *checksum);
+
+
+int
+main (int argc, char *argv[])
+{
+    InputArgs args;
+    EdgeList ref, elist;
+    double mb, t, best_stdio, best_mmap, best_par, best_load;
+    double best_hsearch, best_idmap, m2, slots;
+    double best_plain, best_packed, plain_mb, packed_mb;
+    double best_order[NUM_ORDERS];
+    int i, reps, order;
+    node_t n, *ids, *ref_ids, *new_ids, num_sources;
+    IdMap map;
+    SparseUGraph graph;
+    uint64_t plain_sum, packed_sum;
+
+    if (argc < 2) {
+        printf("%s: <edgelist-file> [repetitions] [threads]\n", argv[0]);
+        exit(1);
+    }
+    reps = (argc > 2) ? atoi(argv[2]) : 3;
+    args.headerless = 0;
+    args.num_threads = (argc > 3) ? atoi(argv[3])
+                                  : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    strcpy(args.infile, argv[1]);
+    mb = fileSize(args.infile) / (1024.0 * 1024.0);
+    printf("Params: edgelist=%s (%.1f MB), repetitions=%d, threads=%d\n",
+           args.infile, mb, reps, args.num_threads);
+
+    // parse only: fscanf loop vs. mmap scanner on one and on all threads;
+    // keep the best of `reps` runs
+    best_stdio = best_mmap = best_par = best_load = -1;
+    for (i = 0; i < reps; i++) {
+        t = parseWithStdio(args.infile, &ref);
+        if (best_stdio < 0 || t < best_stdio) best_stdio = t;
+        t = parseWithMmap(args.infile, &elist, 1);
+        if (best_mmap < 0 || t < best_mmap) best_mmap = t;
+        assertSameEdges(&ref, &elist);
+        freeEdgeList(&elist);
+
+        t = parseWithMmap(args.infile, &elist, args.num_threads);
+        if (best_par < 0 || t < best_par) best_par = t;
+        assertSameEdges(&ref, &elist);
+        freeEdgeList(&elist);
+        if (i < reps-1) freeEdgeList(&ref);
+    }
+
+    // id remapping only: glibc hsearch on id strings vs. IdMap
+    mapNodeIds(&ref, &ids, &n, &map);
+    freeIdMap(&map);
+    ref_ids = tmalloc(ref.length * 2 * sizeof(node_t));
+    new_ids = tmalloc(ref.length * 2 * sizeof(node_t));
+    best_hsearch = best_idmap = -1;
+    for (i = 0; i < reps; i++) {
+        t = remapWithHsearch(&ref, ids, n, ref_ids);
+        if (best_hsearch < 0 || t < best_hsearch) best_hsearch = t;
+        t = remapWithIdMap(&ref, ids, n, new_ids);
+        if (best_idmap < 0 || t < best_idmap) best_idmap = t;
+        assert(memcmp(ref_ids, new_ids, ref.length * 2 * sizeof(node_t)) == 0);
+    }
+    m2 = ref.length * 2.0;
+    free(ref_ids);
+    free(new_ids);
+    free(ids);
+    freeEdgeList(&ref);
+
+    // full load into a SparseUGraph
+    for (i = 0; i < reps; i++) {
+        t = loadGraph(&args);
+        if (best_load < 0 || t < best_load) best_load = t;
+    }
+
+    // BFS over the plain and the packed adjacency; both must find the
+    // same predecessors
+    readSparseUGraph(&args, &graph);
+    num_sources = (graph.n < BENCH_BFS_SOURCES) ? graph.n : BENCH_BFS_SOURCES;
+    plain_mb = graph.m*2 * sizeof(node_t) / (1024.0 * 1024.0);
+    best_plain = best_packed = -1;
+    for (i = 0; i < reps; i++) {
+        t = timeBFS(&graph, num_sources, &plain_sum);
+        if (best_plain < 0 || t < best_plain) best_plain = t;
+    }
+    packSparseUGraph(&graph);
+    packed_mb = graph.packed.size / (1024.0 * 1024.0);
+    for (i = 0; i < reps; i++) {
+        t = timeBFS(&graph, num_sources, &packed_sum);
+        if (best_packed < 0 || t < best_packed) best_packed = t;
+    }
+    assert(plain_sum == packed_sum);
+    slots = graph.m * 2.0 * num_sources;  // scanned per run
+    freeSparseUGraph(&graph);
+
+    // BFS after each node ordering, from the same (highest degree) sources
+    for (order = 0; order < NUM_ORDERS; order++) {
+        readSparseUGraph(&args, &graph);
+        reorderSparseUGraph(&graph, order);
+        best_order[order] = -1;
+        for (i = 0; i < reps; i++) {
+            t = timeBFS(&graph, num_sources, &plain_sum);
+            if (best_order[order] < 0 || t < best_order[order]) best_order[order] = t;
+        }
+        freeSparseUGraph(&graph);
+    }
+
+    printf("parse (fscanf): %8.3f s  %8.1f MB/s\n", best_stdio, mb / best_stdio);
+    printf("parse (mmap):   %8.3f s  %8.1f MB/s\n", best_mmap, mb / best_mmap);
+    printf("parse (%2d thr): %8.3f s  %8.1f MB/s\n",
+           args.num_threads, best_par, mb / best_par);
+    printf("remap (hsearch):%8.3f s  %8.1f M lookups/s\n",
+           best_hsearch, m2 / best_hsearch * 1e-6);
+    printf("remap (IdMap):  %8.3f s  %8.1f M lookups/s\n",
+           best_idmap, m2 / best_idmap * 1e-6);
+    printf("full load:      %8.3f s  %8.1f MB/s\n", best_load, mb / best_load);
+    printf("bfs (plain):    %8.3f s  %8.1f M slots/s  %8.1f MB adjacency\n",
+           best_plain, slots / best_plain * 1e-6, plain_mb);
+    printf("bfs (packed):   %8.3f s  %8.1f M slots/s  %8.1f MB adjacency\n",
+           best_packed, slots / best_packed * 1e-6, packed_mb);
+    for (order = 0; order < NUM_ORDERS; order++) {
+        printf("bfs (%-6s):   %8.3f s  %8.1f M slots/s\n", order_names[order],
+               best_order[order], slots / best_order[order] * 1e-6);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+// seconds on a monotonic clock
+double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+off_t fileSize(char *path)
+{
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        fprintf(stderr, "Unable to open graph edgelist: %s", path);
+        error(BAD_FP);
+    }
+    return st.st_size;
+}
+
+// reference reader: the original fscanf loop
+double parseWithStdio(char *path, EdgeList *elist)
+{
+    FILE *fpin;
+    node_t n;
+    edge_t m, edge_idx=0;
+    double start = wallTime();
+
+    fpin = fopen(path, "r");
+    if (fpin == NULL) error(BAD_FP);
+    fscanf(fpin, "%" SCNnode " %" SCNedge, &n, &m);
+    newEdgeList(elist, m);
+    while (edge_idx < m && fscanf(fpin, "%" SCNnode " %" SCNnode,
+                                  &elist->nodes[ICOL][edge_idx],
+                                  &elist->nodes[JCOL][edge_idx]) == 2) {
+        edge_idx++;
+    }
+    fclose(fpin);
+    return wallTime() - start;
+}
+
+double parseWithMmap(char *path, EdgeList *elist, int num_threads)
+{
+    node_t n;
+    edge_t m;
+    double start = wallTime();
+    readEdgeListFile(path, elist, &n, &m, num_threads, 0);
+    return wallTime() - start;
+}
+
+// every parser must agree on every endpoint
+void assertSameEdges(EdgeList *a, EdgeList *b)
+{
+    assert(a->length == b->length);
+    assert(memcmp(a->nodes[ICOL], b->nodes[ICOL], a->length * sizeof(node_t)) == 0);
+    assert(memcmp(a->nodes[JCOL], b->nodes[JCOL], a->length * sizeof(node_t)) == 0);
+}
+
+double loadGraph(InputArgs *args)
+{
+    SparseUGraph graph;
+    double start = wallTime(), elapsed;
+    readSparseUGraph(args, &graph);
+    elapsed = wallTime() - start;
+    freeSparseUGraph(&graph);
+    return elapsed;
+}
+
+// reference id map: the original per-lookup key string in the global
+// hsearch table; time building the map for `n` ids and translating
+// every endpoint
+double remapWithHsearch(EdgeList *elist, node_t *ids, node_t n, node_t *out)
+{
+    ENTRY e, *ep;
+    char key[24];
+    char *keys = tcalloc(n, sizeof(key));
+    node_t *values = tcalloc(n, sizeof(node_t));
+    edge_t i;
+    int col;
+    double start = wallTime();
+
+    hcreate((int)(n + n*0.25 + 0.5));
+    for (i = 0; i < n; i++) {
+        sprintf(&keys[i*sizeof(key)], "%" PRInode, ids[i]);
+        values[i] = i;
+        e.key = &keys[i*sizeof(key)];
+        e.data = &values[i];
+        hsearch(e, ENTER);
+    }
+    for (col = ICOL; col <= JCOL; col++) {
+        for (i = 0; i < elist->length; i++) {
+            sprintf(key, "%" PRInode, elist->nodes[col][i]);
+            e.key = tcalloc(sizeof(key), sizeof(char));
+            snprintf(e.key, sizeof(key), "%s", key);
+            ep = hsearch(e, FIND);
+            free(e.key);
+            out[col*elist->length + i] = *(node_t *)ep->data;
+        }
+    }
+    hdestroy();
+    start = wallTime() - start;
+    free(keys);
+    free(values);
+    return start;
+}
+
+double remapWithIdMap(EdgeList *elist, node_t *ids, node_t n, node_t *out)
+{
+    IdMap map;
+    edge_t i;
+    int col;
+    double start = wallTime();
+
+    newIdMap(&map, n, ids[0], ids[n-1]);
+    for (i = 0; i < n; i++) {
+        idMapInsert(&map, ids[i], i);
+    }
+    for (col = ICOL; col <= JCOL; col++) {
+        for (i = 0; i < elist->length; i++) {
+            out[col*elist->length + i] = idMapLookup(&map, elist->nodes[col][i]);
+        }
+    }
+    freeIdMap(&map);
+    return wallTime() - start;
+}
+
+// run a BFS from each of the `num_sources` highest degree nodes and sum
+// up the predecessors found, for comparing layouts
+double timeBFS(SparseUGraph *graph, node_t num_sources, uint64_t *checksum)
+{
+    BFSInfo info;
+    node_t s, v;
+    edge_t j;
+    double start, elapsed = 0;
+
+    resetNodeOrder(graph);
+    calculateDegreeAndSort(graph);
+    newBFSInfo(&info, graph, &graph->scratch);
+    *checksum = 0;
+    for (s = 0; s < num_sources; s++) {
+        info.src = graph->node_id[graph->n-1 - s];
+        start = wallTime();
+        bfs(graph, &info);
+        elapsed += wallTime() - start;
+        for (v = 0; v < graph->n; v++) {
+            for (j = 0; j < info.pred[v].size; j++) {
+                *checksum = *checksum * 31 + info.pred[v].data[j];
+            }
+        }
+    }
+    arenaReset(&graph->scratch);
+    return elapsed;
+}
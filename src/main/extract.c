@@ -0,0 +1,143 @@
+#include "graph.h"
+
+
+void printUsage(char *prog);
+void writeLabelsAsCommunities(char *labels_path, char *outfile);
+
+
+int
+main (int argc, char *argv[])
+{
+    int opt;
+    node_t k = -1, level, u, c, num_comms, *label;
+    double threshold = 0.0;
+    int by_modularity = 0, from_labels = 0;
+    DendroFile df;
+    DendroLevel *lv;
+    Vector *comms;
+    struct option long_opts[] = {
+        {"communities", required_argument, NULL, 'k'},
+        {"modularity", required_argument, NULL, 'q'},
+        {"labels", no_argument, NULL, 'l'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "k:q:l", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'k':  // the first level with at least this many communities
+            k = atol(optarg);
+            if (k < 1) printUsage(argv[0]);
+            break;
+        case 'q':  // the first level with at least this modularity
+            threshold = strtod(optarg, NULL);
+            by_modularity = 1;
+            break;
+        case 'l':  // the input is a labels file written by gn -L
+            from_labels = 1;
+            break;
+        default:
+            printUsage(argv[0]);
+        }
+    }
+    if (k > 0 && by_modularity) printUsage(argv[0]);
+    if (from_labels) {
+        if (k > 0 || by_modularity || argc - optind != 2) printUsage(argv[0]);
+        writeLabelsAsCommunities(argv[optind], argv[optind+1]);
+        exit(EXIT_SUCCESS);
+    }
+    if (k < 0 && !by_modularity) {  // no partition asked for: list the levels
+        if (argc - optind != 1) printUsage(argv[0]);
+    } else if (argc - optind != 2) {
+        printUsage(argv[0]);
+    }
+
+    mapDendrogramFile(argv[optind], &df);
+    if (k < 0 && !by_modularity) {
+        printf("level  iteration  edges_cut  communities  modularity\n");
+        for (level = 0; level < df.hdr->num_levels; level++) {
+            lv = &df.levels[level];
+            printf("%5" PRInode "  %9" PRId64 "  %9" PRId64 "  %11" PRId64 "  %10.6f\n",
+                   level, lv->iteration, lv->edges_cut, lv->num_clusters, lv->modularity);
+        }
+        unmapFile(&df.mf);
+        exit(EXIT_SUCCESS);
+    }
+
+    // levels only ever gain communities, so take the first that qualifies
+    for (level = 0; level < df.hdr->num_levels; level++) {
+        lv = &df.levels[level];
+        if (by_modularity ? lv->modularity >= threshold : lv->num_clusters >= k) break;
+    }
+    if (level == df.hdr->num_levels) {
+        fprintf(stderr, "%s: no level reaches %s %g; the run stopped at %" PRId64
+                " communities\n", argv[optind], by_modularity ? "modularity" : "k",
+                by_modularity ? threshold : (double)k,
+                df.levels[df.hdr->num_levels-1].num_clusters);
+        error(BAD_INPUT);
+    }
+    lv = &df.levels[level];
+    printf("level %" PRInode ": iteration %" PRId64 ", %" PRId64 " edges cut, %" PRId64
+           " communities, modularity %f\n",
+           level, lv->iteration, lv->edges_cut, lv->num_clusters, lv->modularity);
+
+    // gather the members of every community and write them out
+    label = tmalloc(df.hdr->n * sizeof(node_t));
+    num_comms = dendrogramPartition(&df, level, label);
+    assert(num_comms == lv->num_clusters);
+    comms = tcalloc(num_comms, sizeof(Vector));
+    for (c = 0; c < num_comms; c++) {
+        newVector(&comms[c]);
+    }
+    for (u = 0; u < df.hdr->n; u++) {
+        vectorAppend(&comms[label[u]], u);
+    }
+    writeCommunities(df.id, comms, num_comms, argv[optind+1], 1);
+
+    for (c = 0; c < num_comms; c++) {
+        freeVector(&comms[c]);
+    }
+    free(comms);
+    free(label);
+    unmapFile(&df.mf);
+    exit(EXIT_SUCCESS);
+}
+
+// Write the communities of a labels file in the text format of
+// `writeCommunities`, which is exactly what gn wrote alongside it
+void writeLabelsAsCommunities(char *labels_path, char *outfile)
+{
+    LabelsFile lf;
+    Vector *comms;
+    node_t u, c;
+
+    mapLabelsFile(labels_path, &lf);
+    comms = tcalloc(lf.k > 0 ? lf.k : 1, sizeof(Vector));
+    for (c = 0; c < lf.k; c++) {
+        newVector(&comms[c]);
+    }
+    for (u = 0; u < lf.n; u++) {
+        if (nodeLabel(&lf, u) == NO_LABEL) continue;
+        if (nodeLabel(&lf, u) >= (uint32_t)lf.k) {
+            fprintf(stderr, "%s: label %" PRIu32 " of node %" PRInode " is out "
+                    "of range\n", labels_path, nodeLabel(&lf, u), u);
+            error(BAD_INPUT);
+        }
+        vectorAppend(&comms[nodeLabel(&lf, u)], u);
+    }
+    writeCommunities(lf.id, comms, lf.k, outfile, 1);
+
+    for (c = 0; c < lf.k; c++) {
+        freeVector(&comms[c]);
+    }
+    free(comms);
+    unmapLabelsFile(&lf);
+}
+
+void printUsage(char *prog)
+{
+    printf("%s: <dendrogram-file>\n"
+           "%s: -k communities | -q modularity <dendrogram-file> <outfile>\n"
+           "%s: -l <labels-file> <outfile>\n",
+           prog, prog, prog);
+    exit(1);
+}
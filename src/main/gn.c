@@ -1,207 +1,145 @@
 #include "graph.h"
 
 
+void printUsage(char *prog);
+
+
 int
 main (int argc, char *argv[])
 {
-    int k, i;
+    node_t k, i;
+    int opt, packed = 0, order = ORDER_NONE, alloc_stats = 0;
     Vector *comms;
     SparseUGraph graph;
     InputArgs args;
+    char *labels_path = NULL, *dendro_path = NULL;
+    char *ckpt_path = NULL, *resume_path = NULL;
+    double ckpt_interval = CHECKPOINT_INTERVAL;
+    Dendrogram dendro;
+    Checkpoint ckpt;
+    struct option long_opts[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"no-header", no_argument, NULL, 'H'},
+        {"order", required_argument, NULL, 'O'},
+        {"packed", no_argument, NULL, 'P'},
+        {"labels", required_argument, NULL, 'L'},
+        {"dendrogram", required_argument, NULL, 'D'},
+        {"checkpoint", required_argument, NULL, 'C'},
+        {"checkpoint-interval", required_argument, NULL, 'I'},
+        {"resume", required_argument, NULL, 'R'},
+        {"alloc-stats", no_argument, NULL, 'S'},
+        {NULL, 0, NULL, 0}
+    };
+
+    // parse options; by default use every online core for reading
+    args.num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    args.headerless = 0;
+    while ((opt = getopt_long(argc, argv, "t:HO:PL:D:C:I:R:S", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 't':
+            args.num_threads = atoi(optarg);
+            break;
+        case 'H':  // no "#nodes #edges" line; count while reading
+            args.headerless = 1;
+            break;
+        case 'O':  // renumber nodes for locality, see order.h
+            order = parseOrder(optarg);
+            if (order < 0) printUsage(argv[0]);
+            break;
+        case 'P':  // keep the adjacency varint-packed
+            packed = 1;
+            break;
+        case 'L':  // also write the memberships as a binary labels file
+            labels_path = optarg;
+            break;
+        case 'D':  // also write the split hierarchy, see dendrogram.h
+            dendro_path = optarg;
+            break;
+        case 'C':  // write checkpoints as the run goes, see checkpoint.h
+            ckpt_path = optarg;
+            break;
+        case 'I':  // seconds between checkpoints
+            ckpt_interval = strtod(optarg, NULL);
+            break;
+        case 'R':  // pick up from a checkpoint; keep writing to it unless -C
+            resume_path = optarg;
+            break;
+        case 'S':  // print allocation counts at the end
+            alloc_stats = 1;
+            break;
+        default:
+            printUsage(argv[0]);
+        }
+    }
+    if (args.num_threads < 1) args.num_threads = 1;
 
     // validate input args
-    if (argc < 4) {
-        printf("%s: <edgelist-file> <k> <outfile>\n", argv[0]);
-        exit(1);
-    }
+    if (argc - optind < 3) printUsage(argv[0]);
 
     // check for sample size input
-    if (argc == 5) {
-        args.sample_rate = strtod(argv[4], NULL);
+    if (argc - optind == 4) {
+        args.sample_rate = strtod(argv[optind+3], NULL);
     } else {
         args.sample_rate = 0.2;
     }
 
     // read input arguments
-    strcpy(args.infile, argv[1]);
-    args.num_clusters = atoi(argv[2]);
-    strcpy(args.outfile, argv[3]);
-    printf("Params: edgelist=%s, num_clusters=%d, outfile=%s\n",
-           args.infile, args.num_clusters, args.outfile);
+    strcpy(args.infile, argv[optind]);
+    args.num_clusters = atoi(argv[optind+1]);
+    strcpy(args.outfile, argv[optind+2]);
+    printf("Params: edgelist=%s, num_clusters=%d, outfile=%s, threads=%d\n",
+           args.infile, args.num_clusters, args.outfile, args.num_threads);
 
     // read graph and run Girvan Newman
     readSparseUGraph(&args, &graph);
+    reorderSparseUGraph(&graph, order);
+    if (packed) {
+        packSparseUGraph(&graph);
+        printf("packed adjacency: %.1f MB, plain %.1f MB\n",
+               graph.packed.size / (1024.0 * 1024.0),
+               graph.m*2 * sizeof(node_t) / (1024.0 * 1024.0));
+    }
+    // the ids are only needed to translate the output: keep them in a
+    // mapped sidecar next to the output rather than on the heap
+    storeNodeIds(&graph, args.outfile);
     // printSparseUGraph(&graph, graph.n);
-    k = girvanNewman(&graph, args.num_clusters, args.sample_rate, &comms);
+    if (dendro_path != NULL) newDendrogram(&dendro, &graph);
+    if (ckpt_path == NULL) ckpt_path = resume_path;
+    if (ckpt_path != NULL) {
+        newCheckpoint(&ckpt, &graph, ckpt_path, ckpt_interval);
+        if (resume_path != NULL) {
+            loadCheckpoint(&ckpt, &graph, resume_path, args.num_clusters,
+                           args.sample_rate);
+        }
+    }
+    k = girvanNewman(&graph, args.num_clusters, args.sample_rate, &comms,
+                     (dendro_path != NULL) ? &dendro : NULL,
+                     (ckpt_path != NULL) ? &ckpt : NULL);
 
     // output community memberships
-    writeCommunities(graph.id, comms, k, args.outfile);
+    writeCommunities(graph.id, comms, k, args.outfile, args.num_threads);
+    if (labels_path != NULL) writeLabels(graph.id, graph.n, comms, k, labels_path);
+    if (dendro_path != NULL) {
+        writeDendrogram(&dendro, graph.id, dendro_path);
+        printf("dendrogram: %" PRInode " levels, %" PRInode " clusters\n",
+               dendro.num_levels, dendro.num_clusters);
+        freeDendrogram(&dendro);
+    }
+    if (ckpt_path != NULL) freeCheckpoint(&ckpt);
     for (i = k-1; i >= 0; i--) {
         freeVector(&comms[i]);
     }
     free(comms);
+    if (alloc_stats) printAllocStats(&graph);
     freeSparseUGraph(&graph);
     exit(EXIT_SUCCESS);
 }
 
-// print out node community membership to outfile
-void writeCommunities(int *idmap, Vector *comms, int k, char *outfile)
-{
-    int i, j;
-    FILE *fpout;
-    fpout = fopen(outfile, "w");
-    if (fpout == NULL) {
-        fprintf(stderr, "unable to open output file: %s", outfile);
-        error(BAD_FP);
-    }
-    for (i = 0; i < k; i++) {
-        for (j = 0; j < comms[i].size; j++) {
-            fprintf(fpout, "%d %d\n", idmap[comms[i].data[j]], i);
-        }
-    }
-    fclose(fpout);
-}
-
-
-// Use the Girvan Newman (2004) algorithm to divisely
-// cluster the graph into k partitions.
-int girvanNewman(SparseUGraph *graph, int k, float sample_rate, Vector **comms)
-{
-    Vector largest;     // edges with highest betweenness
-    int edges_cut=0;    // num edges cut so far
-    int iteration=1;    // which iteration the algorithm is on
-    int src, dest, i;
-    int num_comms=0, checkpoint=k;
-
-    assert(graph != NULL);
-    if (graph->m <= 0) return;
-
-    while (num_comms < k && edges_cut < graph->m) {
-        printf("running iteration %d; edges cut so far: %d\n",
-               iteration, edges_cut);
-
-        // Calculate degree, then sample the nodes
-        calculateDegreeAndSort(graph);
-        sampleNodes(graph, sample_rate);
-        if (graph->n_s <= 0) {
-            printf("0 nodes are sampled with a sample rate of %f\n", sample_rate);
-            exit(INVALID_SAMPLE_SIZE);
-        }
-
-        // calculate edge betweenness and cut edge(s) with highest value(s)
-        calculateEdgeBetweenness(graph, &largest);
-        for (i = 0; i < largest.size; i++) {
-            src = largest.data[i++];
-            dest = largest.data[i];
-            cutEdge(graph, src, dest, iteration);
-        }
-        edges_cut += largest.size / 2;
-        iteration++;
-        freeVector(&largest);
-        // printSparseUGraph(graph, graph->n);
-
-        if (edges_cut >= checkpoint) {  // check number of communities
-            num_comms = labelCommunities(graph, comms);
-            // reset if not done
-            if (num_comms < k && edges_cut < graph->m) {
-                for (i = num_comms-1; i >= 0; i--) {
-                    freeVector(comms[i]);
-                }
-                free(*comms);
-                checkpoint += (k - num_comms);  // set next checkpoint
-                printf("communities found so far: %d\n", num_comms);
-            }
-        }
-    }
-    printf("completed %d iterations; total edges cut: %d\n",
-           iteration-1, edges_cut);
-    printf("total communities found: %d\n", num_comms);
-    return num_comms;
-}
-
-// Cut an edge from the graph by marking it with the negative
-// of the iteration number in which it was cut.
-void cutEdge(SparseUGraph *graph, int src, int dest, int iteration)
-{
-    int i;
-    for (i = graph->index[src]; i < graph->index[src+1]; i++) {
-        if (graph->edges[i] == dest) {
-            graph->edges[i] = -iteration;
-        }
-    }
-
-    for (i = graph->index[dest]; i < graph->index[dest+1]; i++) {
-        if (graph->edges[i] == src) {
-            graph->edges[i] = -iteration;
-        }
-    }
-}
-
-// Build up the communities from the divided graph
-// using a union-find data structure
-int labelCommunities(SparseUGraph *graph, Vector **comms)
+void printUsage(char *prog)
 {
-    assert(graph != NULL);
-    int i, idx, j, root, prev_root;
-    int k, comm_id;
-    int *roots, *node_ids;
-    EdgeList elist;
-    UnionFind *uf = uf_create(graph->n);
-
-    // build disjoint sets from graph, ignoring edges that have been cut
-    for (i = 0; i < graph->n; i++) {
-        for (idx = graph->index[i]; idx < graph->index[i+1]; idx++) {
-            j = graph->edges[idx];
-            if (j >= 0) {
-                uf_union(uf, i, j);
-            }
-        }
-    }
-
-    // find root of each node
-    roots = tcalloc(graph->n, sizeof(int));
-    for (i = 0; i < graph->n; i++) {
-        roots[i] = uf_root(uf, i);
-    }
-
-    // assign community ids (naive approach)
-    node_ids = tcalloc(graph->n, sizeof(int));
-    for (i = 0; i < graph->n; i++) {
-        node_ids[i] = i;
-    }
-
-    // sort in tandem, so we have ascending roots
-    // use the EdgeList to sort in tandem.
-    // TODO: move to a more generic sorting function
-    // this allocates a bunch of extra memory and sorts the id array
-    // along with the degree and node_id arrays, so it wastes quite a
-    // lot of resources.
-    assert(graph != NULL);
-    elist.length = graph->n;
-    elist.id = tcalloc(graph->n, sizeof(int));
-    elist.nodes[ICOL] = roots;
-    elist.nodes[JCOL] = node_ids;
-    sortEdges(&elist, ICOL);
-    elist.nodes[ICOL] = NULL;
-    elist.nodes[JCOL] = NULL;
-
-    // get number of communities
-    memcpy(elist.id, roots, graph->n * sizeof(int));
-    k = graph->n;
-    removeDuplicates(elist.id, &k);
-    free(elist.id);
-
-    // now accumulate all community members
-    j = 0;
-    prev_root = -1;
-    *comms = tcalloc(k, sizeof(Vector));
-    for (i = 0; i < k; i++) {
-        newVector(&(*comms)[i]);
-        root = roots[j];
-        vectorAppend(&(*comms)[i], node_ids[j++]);
-        while (roots[j] == root) {
-            vectorAppend(&(*comms)[i], node_ids[j++]);
-        }
-    }
-    return k;
+    printf("%s: [-t threads] [-H] [-O none|degree|bfs|rcm] [-P] [-L labels-file] "
+           "[-D dendrogram-file]\n"
+           "    [-C checkpoint-file] [-I seconds] [-R checkpoint-file] [-S] "
+           "<edgelist-file> <k> <outfile> [sample-rate]\n", prog);
+    exit(1);
 }
@@ -0,0 +1,77 @@
+#include "graph.h"
+
+
+void printUsage(char *prog);
+
+
+int
+main (int argc, char *argv[])
+{
+    int opt, order = ORDER_NONE;
+    size_t budget = 0;
+    SparseUGraph graph;
+    InputArgs args;
+    struct option long_opts[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"no-header", no_argument, NULL, 'H'},
+        {"order", required_argument, NULL, 'O'},
+        {"memory", required_argument, NULL, 'M'},
+        {NULL, 0, NULL, 0}
+    };
+
+    // parse options; by default use every online core for reading
+    args.num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    args.headerless = 0;
+    while ((opt = getopt_long(argc, argv, "t:HO:M:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 't':
+            args.num_threads = atoi(optarg);
+            break;
+        case 'H':  // no "#nodes #edges" line; count while reading
+            args.headerless = 1;
+            break;
+        case 'O':  // renumber nodes for locality, see order.h
+            order = parseOrder(optarg);
+            if (order < 0) printUsage(argv[0]);
+            break;
+        case 'M':  // build out of core in about this many megabytes
+            budget = (size_t)atol(optarg) << 20;
+            if (budget == 0) printUsage(argv[0]);
+            break;
+        default:
+            printUsage(argv[0]);
+        }
+    }
+    if (args.num_threads < 1) args.num_threads = 1;
+    if (argc - optind != 2) printUsage(argv[0]);
+    if (budget > 0 && order != ORDER_NONE) {
+        fprintf(stderr, "reordering needs the in-memory build; drop -M or -O\n");
+        exit(1);
+    }
+
+    strcpy(args.infile, argv[optind]);
+    strcpy(args.outfile, argv[optind+1]);
+    printf("Params: edgelist=%s, snapshot=%s, threads=%d\n",
+           args.infile, args.outfile, args.num_threads);
+
+    // build the CSR once and store it for later runs to map; with a
+    // memory budget, stream it to the snapshot through sorted runs
+    if (budget > 0) {
+        buildSnapshotExternal(&args, budget);
+        printf("snapshot written to %s\n", args.outfile);
+        exit(EXIT_SUCCESS);
+    }
+    readSparseUGraph(&args, &graph);
+    reorderSparseUGraph(&graph, order);
+    writeSnapshot(&graph, args.outfile);
+    printf("snapshot written to %s\n", args.outfile);
+    freeSparseUGraph(&graph);
+    exit(EXIT_SUCCESS);
+}
+
+void printUsage(char *prog)
+{
+    printf("%s: [-t threads] [-H] [-O none|degree|bfs|rcm] [-M megabytes] "
+           "<edgelist-file> <snapshot-file>\n", prog);
+    exit(1);
+}
@@ -0,0 +1,217 @@
+#include "graph.h"
+
+// most graphs processed at once
+#define STRESS_MAX_RUNS     256
+
+// one graph taken from input to communities on a thread of its own
+typedef struct {
+
+    char *infile;
+    node_t k;
+    float sample_rate;
+    int num_threads;    // threads each read uses
+    int headerless;     // no "#nodes #edges" line, see InputArgs
+    int order;
+    int packed;
+    node_t num_comms;
+    uint64_t digest;    // of the communities, hierarchy and betweenness
+
+} StressRun;
+
+double wallTime();
+void *runGraph(void *arg);
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size);
+void printUsage(char *prog);
+
+
+int
+main (int argc, char *argv[])
+{
+    int opt, i, num_inputs, num_runs = 8, failed = 0;
+    StressRun runs[STRESS_MAX_RUNS], *refs;
+    pthread_t threads[STRESS_MAX_RUNS];
+    StressRun proto;
+    double t_seq, t_par;
+    int saved_stdout, devnull;
+    struct option long_opts[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"no-header", no_argument, NULL, 'H'},
+        {"runs", required_argument, NULL, 'n'},
+        {"communities", required_argument, NULL, 'k'},
+        {"sample-rate", required_argument, NULL, 's'},
+        {"order", required_argument, NULL, 'O'},
+        {"packed", no_argument, NULL, 'P'},
+        {NULL, 0, NULL, 0}
+    };
+
+    memset(&proto, 0, sizeof(proto));
+    proto.k = 3;
+    proto.sample_rate = 1.0;
+    proto.num_threads = 1;
+    proto.order = ORDER_NONE;
+    while ((opt = getopt_long(argc, argv, "t:Hn:k:s:O:P", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 't':  // threads each graph is read with
+            proto.num_threads = atoi(optarg);
+            break;
+        case 'H':  // no "#nodes #edges" line; count while reading
+            proto.headerless = 1;
+            break;
+        case 'n':  // graphs processed at once
+            num_runs = atoi(optarg);
+            if (num_runs < 1 || num_runs > STRESS_MAX_RUNS) printUsage(argv[0]);
+            break;
+        case 'k':
+            proto.k = atol(optarg);
+            if (proto.k < 1) printUsage(argv[0]);
+            break;
+        case 's':
+            proto.sample_rate = strtod(optarg, NULL);
+            break;
+        case 'O':  // renumber nodes for locality, see order.h
+            proto.order = parseOrder(optarg);
+            if (proto.order < 0) printUsage(argv[0]);
+            break;
+        case 'P':  // keep the adjacency varint-packed
+            proto.packed = 1;
+            break;
+        default:
+            printUsage(argv[0]);
+        }
+    }
+    if (proto.num_threads < 1) proto.num_threads = 1;
+    num_inputs = argc - optind;
+    if (num_inputs < 1) printUsage(argv[0]);
+    printf("Params: inputs=%d, runs=%d, k=%" PRInode ", sample_rate=%g, threads=%d\n",
+           num_inputs, num_runs, proto.k, proto.sample_rate, proto.num_threads);
+
+    // the library reports every iteration on stdout; keep the runs quiet
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    devnull = open("/dev/null", O_WRONLY);
+    if (saved_stdout < 0 || devnull < 0) {
+        fprintf(stderr, "unable to redirect stdout\n");
+        error(BAD_FP);
+    }
+    dup2(devnull, STDOUT_FILENO);
+
+    // reference results: every input once, one after the other
+    refs = tcalloc(num_inputs, sizeof(StressRun));
+    t_seq = wallTime();
+    for (i = 0; i < num_inputs; i++) {
+        refs[i] = proto;
+        refs[i].infile = argv[optind + i];
+        runGraph(&refs[i]);
+    }
+    t_seq = wallTime() - t_seq;
+
+    // then all runs at once, cycling through the inputs
+    t_par = wallTime();
+    for (i = 0; i < num_runs; i++) {
+        runs[i] = proto;
+        runs[i].infile = argv[optind + i % num_inputs];
+        pthread_create(&threads[i], NULL, runGraph, &runs[i]);
+    }
+    for (i = 0; i < num_runs; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    t_par = wallTime() - t_par;
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    close(devnull);
+
+    for (i = 0; i < num_runs; i++) {
+        if (runs[i].digest != refs[i % num_inputs].digest
+            || runs[i].num_comms != refs[i % num_inputs].num_comms) {
+            printf("run %d (%s): MISMATCH: %" PRInode " communities, digest %016"
+                   PRIx64 ", expected %" PRInode ", %016" PRIx64 "\n",
+                   i, runs[i].infile, runs[i].num_comms, runs[i].digest,
+                   refs[i % num_inputs].num_comms, refs[i % num_inputs].digest);
+            failed++;
+        }
+    }
+    printf("sequential: %d graphs in %.3f s\n", num_inputs, t_seq);
+    printf("concurrent: %d graphs in %.3f s\n", num_runs, t_par);
+    printf("%d of %d runs match their reference\n", num_runs - failed, num_runs);
+    free(refs);
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+// Read one graph, run Girvan-Newman on it with a dendrogram attached and
+// digest everything it produced; `arg` is its StressRun.
+void *runGraph(void *arg)
+{
+    StressRun *run = (StressRun *)arg;
+    uint64_t hash = 14695981039346656037ULL;
+    SparseUGraph graph;
+    InputArgs args;
+    Dendrogram dendro;
+    Vector *comms;
+    node_t c;
+    edge_t j;
+
+    memset(&args, 0, sizeof(args));
+    snprintf(args.infile, sizeof(args.infile), "%s", run->infile);
+    args.num_clusters = run->k;
+    args.sample_rate = run->sample_rate;
+    args.num_threads = run->num_threads;
+    args.headerless = run->headerless;
+
+    readSparseUGraph(&args, &graph);
+    reorderSparseUGraph(&graph, run->order);
+    if (run->packed) packSparseUGraph(&graph);
+    storeNodeIds(&graph, NULL);
+    newDendrogram(&dendro, &graph);
+    run->num_comms = girvanNewman(&graph, run->k, run->sample_rate, &comms,
+                                  &dendro, NULL);
+
+    // communities by original id, so that node orders compare too
+    for (c = 0; c < run->num_comms; c++) {
+        hash = hashBytes(hash, &comms[c].size, sizeof(comms[c].size));
+        for (j = 0; j < comms[c].size; j++) {
+            hash = hashBytes(hash, &graph.id[comms[c].data[j]], sizeof(node_t));
+        }
+        freeVector(&comms[c]);
+    }
+    if (run->num_comms > 0) free(comms);
+    hash = hashBytes(hash, dendro.cluster, dendro.n * sizeof(node_t));
+    hash = hashBytes(hash, dendro.parent, dendro.num_clusters * sizeof(node_t));
+    hash = hashBytes(hash, dendro.birth, dendro.num_clusters * sizeof(node_t));
+    hash = hashBytes(hash, dendro.levels, dendro.num_levels * sizeof(DendroLevel));
+    if (graph.edge_bet != NULL) {
+        hash = hashBytes(hash, graph.edge_bet, graph.m * sizeof(float));
+    }
+    run->digest = hash;
+    freeDendrogram(&dendro);
+    freeSparseUGraph(&graph);
+    return NULL;
+}
+
+// FNV-1a hash of `size` bytes at `data`, continuing from `hash`
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void printUsage(char *prog)
+{
+    printf("%s: [-t threads] [-H] [-n runs] [-k communities] [-s sample-rate] "
+           "[-O none|degree|bfs|rcm] [-P]\n"
+           "    <edgelist-or-snapshot-file>...\n", prog);
+    exit(1);
+}
@@ -2,59 +2,76 @@
 
 
 void
-calculateDegreeAndSort(SparseUGraph *graph)
+orderNodesById(SparseUGraph *graph)
+{   // sort the nodes by original id; keep nothing if already in order
+    node_t i, *keys;
+
+    assert(graph != NULL && graph->node_id != NULL);
+    for (i = 1; i < graph->n && graph->id != NULL; i++) {
+        if (graph->id[i-1] > graph->id[i]) break;
+    }
+    if (graph->id == NULL || i >= graph->n) {
+        graph->id_order = NULL;
+    } else {
+        if (graph->id_order == NULL) {
+            graph->id_order = arenaAlloc(&graph->arena, graph->n * sizeof(node_t));
+        }
+        keys = arenaAlloc(&graph->scratch, graph->n * sizeof(node_t));
+        memcpy(keys, graph->id, graph->n * sizeof(node_t));
+        for (i = 0; i < graph->n; i++) {
+            graph->id_order[i] = i;
+        }
+        radixSortKeysIn(keys, graph->id_order, NULL, graph->n, &graph->scratch);
+        arenaReset(&graph->scratch);
+    }
+    resetNodeOrder(graph);
+}
+
+void
+resetNodeOrder(SparseUGraph *graph)
 {
-    int index_idx = 0, degree_idx = 0;
-    int prev_value = 0, cur_value = 0;
+    node_t i;
+
+    for (i = 0; i < graph->n; i++) {
+        graph->node_id[i] = (graph->id_order != NULL) ? graph->id_order[i] : i;
+    }
+}
+
+void
+calculateDegreeAndSort(SparseUGraph *graph)
+{   // degree i is the live degree of node_id[i], so that nodes whose edges
+    // have all been cut drop out of the sample; ties keep the order of the
+    // last sort
+    node_t i;
 
     assert(graph != NULL);
     assert(graph->index != NULL);
 
     if (graph->degree == NULL) {
-        graph->degree = (int *)tcalloc(graph->n, sizeof(int));
+        graph->degree = arenaAlloc(&graph->arena, graph->n * sizeof(node_t));
     }
 
-    prev_value = graph->index[index_idx];
-    for (index_idx = 1; index_idx < graph->n+1; index_idx++) {
-        cur_value = graph->index[index_idx];
-        graph->degree[degree_idx] = (cur_value - prev_value);
-        prev_value = cur_value;
-        degree_idx++;
+    for (i = 0; i < graph->n; i++) {
+        graph->degree[i] = liveDegree(graph, graph->node_id[i]);
     }
     sortDegree(graph);
 }
 
 void sortDegree(SparseUGraph *graph)
-{
-    int i, j;
-    EdgeList elist;
+{   // sort the nodes by degree, carrying node_id along
     assert(graph != NULL);
-
-    // use the EdgeList to sort the nodes by degree
-    // TODO: move to a more generic sorting function
-    // this allocates a bunch of extra memory and sorts the id array
-    // along with the degree and node_id arrays, so it wastes quite a
-    // lot of resources.
-    newEdgeList(&elist, graph->n);
-    free(elist.nodes[ICOL]);
-    free(elist.nodes[JCOL]);
-    elist.nodes[ICOL] = graph->degree;
-    elist.nodes[JCOL] = graph->node_id;
-    sortEdges(&elist, ICOL);
-    elist.nodes[ICOL] = NULL;
-    elist.nodes[JCOL] = NULL;
-    free(elist.id);
+    radixSortKeysIn(graph->degree, graph->node_id, NULL, graph->n, &graph->scratch);
 }
 
 void
 sampleNodes(SparseUGraph *graph, float sample_rate)
 {
-    int i, j=0;
+    node_t i, j=0;
     assert(graph != NULL);
-    if (graph->sample != NULL) free(graph->sample);
 
-    graph->n_s = (int) ((graph->n * sample_rate) + .5);
-    graph->sample = (int *)tcalloc(graph->n_s, sizeof(int));
+    // the sample is only good for one iteration
+    graph->n_s = (node_t) ((graph->n * sample_rate) + .5);
+    graph->sample = arenaAlloc(&graph->scratch, graph->n_s * sizeof(node_t));
 
     for (i = graph->n-1; i > (graph->n - graph->n_s)-1; i--) {
         graph->sample[j++] = graph->node_id[i];
@@ -66,11 +83,11 @@ printDegree(SparseUGraph *graph)
 {   // print out node degrees
     assert(graph != NULL);
     assert(graph->degree != NULL);
-    int i;
+    node_t i;
 
     printf("node:\tdegree\n");
     for (i = 0; i < graph->n; i++) {
-        printf("%d:\t%d\n", graph->node_id[i], graph->degree[i]);
+        printf("%" PRInode ":\t%" PRInode "\n", graph->node_id[i], graph->degree[i]);
 
     }
 }
@@ -81,8 +98,9 @@ calculateEdgeBetweenness(SparseUGraph *graph, Vector *largest)
     // note that multiple calls calculate multiple times
     assert(graph != NULL);
     BFSInfo info;
-    int i, j, pred, node, edge_id;
-    float flow[graph->m];
+    node_t i, pred, node;
+    edge_t j, edge_id;
+    float *flow;
     float coeff, c;
     float new_val;
     float largest_val; // largest value seen so far
@@ -101,24 +119,25 @@ calculateEdgeBetweenness(SparseUGraph *graph, Vector *largest)
 
     // begin calculations
     newVector(largest);
-    newBFSInfo(&info, graph->n);
+    newBFSInfo(&info, graph, &graph->scratch);
+    flow = arenaAlloc(&graph->scratch, graph->n * sizeof(float));
     largest_val = 0.0;
     for (i = 0; i < graph->n_s; i++) {
         info.src = graph->sample[i];  // perform bfs from src node
         bfs(graph, &info);
 
         // now work back up from each other node to calculate betweenness
-        memset(flow, 0.0, sizeof(flow));
+        memset(flow, 0, graph->n * sizeof(float));
         while (info.stack.size > 0) {
             node = vectorPop(&info.stack);
             coeff = (1.0 + flow[node]) / info.sigma[node];
 
             // for all predecessors
-            for (j = 0; j < info.pred[node].size; j++) {
-                pred = info.pred[node].data[j];    // predecessor node id
+            for (j = 0; j < info.pred[node].size; j += 2) {
+                pred = info.pred[node].data[j];         // predecessor node id
+                edge_id = info.pred[node].data[j+1];    // edge (pred, node)
                 c = info.sigma[pred] * coeff;
                 flow[pred] += c;
-                edge_id = findEdgeId(graph, node, pred);
                 graph->edge_bet[edge_id] += c;
 
                 // check for new largest
@@ -139,7 +158,6 @@ calculateEdgeBetweenness(SparseUGraph *graph, Vector *largest)
             }
         }
     }
-    freeBFSInfo(&info);
 }
 
 // print out edge betweenness per edge
@@ -148,12 +166,14 @@ printEdgeBetweenness(SparseUGraph *graph)
 {
     assert(graph != NULL);
     assert(graph->edge_bet != NULL);
-    int i, j, edge_id;
+    assert(graph->packed.bytes == NULL);
+    node_t i;
+    edge_t j, edge_id;
 
     for (i = 0; i < graph->n; i++) {
         for (j = graph->index[i]; j < graph->index[i+1]; j++) {
-            edge_id = graph->edge_id[j];
-            printf("%d: (%d, %d): %f\n",
+            edge_id = edgeIdAt(graph, i, j);
+            printf("%" PRIedge ": (%" PRInode ", %" PRInode "): %f\n",
                    edge_id, i, graph->edges[j], graph->edge_bet[edge_id]);
         }
     }
@@ -2,12 +2,13 @@
 
 
 float
-modularity(SparseUGraph *graph, Vector *communities, int num_comm)
+modularity(SparseUGraph *graph, Vector *communities, node_t num_comm)
 {
-    int i, j;
-    int m;
-    int e_i = 0;
-    int expected_e = 0;
+    node_t i;
+    edge_t j;
+    edge_t m;
+    edge_t e_i = 0;
+    edge_t expected_e = 0;
     float actual_edges = 0.0f, random_edges = 0.0f;
 
     m = graph->m;
@@ -21,7 +22,8 @@ modularity(SparseUGraph *graph, Vector *communities, int num_comm)
         }
         // add the tally on for the community
         actual_edges += ((float) e_i / (float) (m*2));
-        random_edges += ((float) expected_e * (float) expected_e) / (4 * (m * m));
+        random_edges += ((float) expected_e * (float) expected_e)
+                        / (4 * ((float) m * (float) m));  // m*m overflows edge_t
 
         // reset for the next community
         e_i = 0;
@@ -30,20 +32,11 @@ modularity(SparseUGraph *graph, Vector *communities, int num_comm)
     return (actual_edges - random_edges);
 }
 
-int
-getEdgesInComm(SparseUGraph *graph, int node) {
-    int i, j;
-    int start_idx, end_idx;
-    int edge_counter = 0;
-    start_idx = graph->index[node];
-    end_idx = graph->index[node+1];
-
-    for (i = start_idx; i < end_idx; i++) {
-        if (graph->edges[i] > -1) edge_counter++;
-    }
-    return edge_counter;
+edge_t
+getEdgesInComm(SparseUGraph *graph, node_t node) {
+    return liveDegree(graph, node);
 }
 
-int getDegreeInNetwork(SparseUGraph *graph, int node) {
+edge_t getDegreeInNetwork(SparseUGraph *graph, node_t node) {
     return (graph->degree[node]);
 }
@@ -0,0 +1,196 @@
+#include "graph.h"
+
+
+// runs of neighbors at most this long are sorted by insertion
+#define SHORT_RUN   32
+
+const char *order_names[NUM_ORDERS] = {"none", "degree", "bfs", "rcm"};
+
+// a node with its degree, for sorting runs of neighbors
+typedef struct {
+
+    edge_t degree;
+    node_t node;
+
+} RankedNode;
+
+int
+parseOrder(const char *name)
+{   // return the ORDER_* value named `name`, or -1
+    int order;
+    for (order = 0; order < NUM_ORDERS; order++) {
+        if (strcmp(name, order_names[order]) == 0) return order;
+    }
+    return -1;
+}
+
+static int
+compareRankedNodes(const void *a, const void *b)
+{
+    const RankedNode *x = a, *y = b;
+    if (x->degree != y->degree) return (x->degree > y->degree) - (x->degree < y->degree);
+    return (x->node > y->node) - (x->node < y->node);
+}
+
+#define nodeDegree(graph, u)    ((graph)->index[(u)+1] - (graph)->index[u])
+
+// fill `order` with all nodes by ascending, or if `descending` by
+// descending, degree; equal degrees keep ascending node order
+static void
+sortByDegree(SparseUGraph *graph, node_t *order, int descending)
+{
+    node_t u, *keys = tmalloc(graph->n * sizeof(node_t));
+
+    for (u = 0; u < graph->n; u++) {
+        keys[u] = (node_t)nodeDegree(graph, u);
+        if (descending) keys[u] = -keys[u];
+        order[u] = u;
+    }
+    radixSortKeys(keys, order, NULL, graph->n);
+    free(keys);
+}
+
+// sort order[start, end) by ascending degree, then node
+static void
+sortRunByDegree(SparseUGraph *graph, node_t *order, node_t start, node_t end)
+{
+    node_t i, j, u;
+    edge_t deg;
+    RankedNode *run;
+
+    if (end - start <= SHORT_RUN) {
+        for (i = start+1; i < end; i++) {
+            u = order[i];
+            deg = nodeDegree(graph, u);
+            for (j = i; j > start && (nodeDegree(graph, order[j-1]) > deg
+                                      || (nodeDegree(graph, order[j-1]) == deg
+                                          && order[j-1] > u)); j--) {
+                order[j] = order[j-1];
+            }
+            order[j] = u;
+        }
+        return;
+    }
+
+    run = tmalloc((end - start) * sizeof(RankedNode));
+    for (i = start; i < end; i++) {
+        run[i-start].degree = nodeDegree(graph, order[i]);
+        run[i-start].node = order[i];
+    }
+    qsort(run, end - start, sizeof(RankedNode), compareRankedNodes);
+    for (i = start; i < end; i++) {
+        order[i] = run[i-start].node;
+    }
+    free(run);
+}
+
+// Fill `order` with all nodes in breadth-first order, using `order`
+// itself as the queue. Each component is started from its largest hub,
+// or for Cuthill-McKee (`rcm`) from its smallest degree node, with the
+// newly found neighbors of every node queued by ascending degree and the
+// final order reversed.
+static void
+breadthFirstOrder(SparseUGraph *graph, node_t *order, int rcm)
+{
+    node_t *starts, s, u, v, head = 0, tail = 0, first;
+    edge_t i;
+    char *seen;
+
+    starts = tmalloc(graph->n * sizeof(node_t));
+    sortByDegree(graph, starts, !rcm);
+    seen = tcalloc(graph->n, sizeof(char));
+    for (s = 0; s < graph->n; s++) {
+        if (seen[starts[s]]) continue;
+        seen[starts[s]] = 1;
+        order[tail++] = starts[s];
+        while (head < tail) {
+            u = order[head++];
+            first = tail;
+            for (i = graph->index[u]; i < graph->index[u+1]; i++) {
+                v = graph->edges[i];
+                if (seen[v]) continue;
+                seen[v] = 1;
+                order[tail++] = v;
+            }
+            if (rcm) sortRunByDegree(graph, order, first, tail);
+        }
+    }
+    free(seen);
+    free(starts);
+
+    if (rcm) {
+        for (s = 0; s < graph->n/2; s++) {
+            u = order[s];
+            order[s] = order[graph->n-1 - s];
+            order[graph->n-1 - s] = u;
+        }
+    }
+}
+
+// Rebuild the CSR arrays and the id array so that node order[u] becomes
+// node u. Edge ids follow the new slots.
+static void
+renumberNodes(SparseUGraph *graph, node_t *order)
+{
+    node_t u, old, *perm, *id = NULL, *edges;
+    edge_t i, j, *index;
+
+    perm = tmalloc(graph->n * sizeof(node_t));
+    for (u = 0; u < graph->n; u++) {
+        perm[order[u]] = u;
+    }
+
+    index = tmalloc((graph->n+1) * sizeof(edge_t));
+    edges = tmalloc(graph->m*2 * sizeof(node_t));
+    if (graph->id != NULL) id = tmalloc(graph->n * sizeof(node_t));
+    index[0] = 0;
+    for (u = 0; u < graph->n; u++) {
+        old = order[u];
+        if (id != NULL) id[u] = graph->id[old];
+        j = index[u];
+        for (i = graph->index[old]; i < graph->index[old+1]; i++, j++) {
+            edges[j] = perm[graph->edges[i]];
+        }
+        index[u+1] = j;
+        sortRow(edges, index[u], index[u+1]);
+    }
+    free(perm);
+
+    // the old arrays of a snapshot belong to its mapping, which the
+    // graph no longer needs
+    if (graph->snapshot.data != NULL) {
+        unmapFile(&graph->snapshot);
+    } else {
+        free(graph->index);
+        free(graph->edges);
+        free(graph->lower);
+        free(graph->lower_id);
+        free(graph->id);
+    }
+    graph->index = index;
+    graph->edges = edges;
+    graph->id = id;
+    graph->lower = tmalloc((graph->n+1) * sizeof(edge_t));
+    graph->lower_id = tmalloc(graph->m * sizeof(edge_t));
+    indexEdgeSlots(graph, 1);
+    orderNodesById(graph);
+}
+
+void
+reorderSparseUGraph(SparseUGraph *graph, int order)
+{   // renumber the nodes of a freshly read graph in ORDER_* `order`
+    node_t *new_order;
+
+    assert(graph != NULL && graph->packed.bytes == NULL && graph->live == NULL);
+    assert(graph->id_file.data == NULL);
+    if (order == ORDER_NONE || graph->n == 0) return;
+
+    new_order = tmalloc(graph->n * sizeof(node_t));
+    if (order == ORDER_DEGREE) {
+        sortByDegree(graph, new_order, 1);
+    } else {
+        breadthFirstOrder(graph, new_order, order == ORDER_RCM);
+    }
+    renumberNodes(graph, new_order);
+    free(new_order);
+}
@@ -0,0 +1,76 @@
+#include "graph.h"
+
+
+uint8_t *
+writeVarint(uint8_t *p, uint64_t val)
+{   // encode `val` at `p`; return the byte after it
+    while (val >= 0x80) {
+        *p++ = (uint8_t)val | 0x80;
+        val >>= 7;
+    }
+    *p++ = (uint8_t)val;
+    return p;
+}
+
+// number of bytes `writeVarint` takes for `val`
+static size_t
+varintSize(uint64_t val)
+{
+    size_t len = 1;
+    while (val >= 0x80) {
+        val >>= 7;
+        len++;
+    }
+    return len;
+}
+
+// Replace the `edges` array of a freshly read graph (no edges cut yet)
+// by the packed byte stream. One pass sizes every row so
+// the stream is allocated exactly, a second one encodes it.
+void
+packSparseUGraph(SparseUGraph *graph)
+{
+    PackedAdj *adj = &graph->packed;
+    node_t u, nbr;
+    edge_t i;
+    uint8_t *p;
+
+    assert(graph != NULL && adj->bytes == NULL && graph->live == NULL);
+    adj->start = tmalloc((graph->n+1) * sizeof(size_t));
+    adj->size = 0;
+    for (u = 0; u < graph->n; u++) {
+        adj->start[u] = adj->size;
+        nbr = u;
+        for (i = graph->index[u]; i < graph->index[u+1]; i++) {
+            assert(graph->edges[i] >= 0);
+            adj->size += varintSize(zigzag((int64_t)graph->edges[i] - nbr));
+            nbr = graph->edges[i];
+        }
+    }
+    adj->start[graph->n] = adj->size;
+
+    adj->bytes = tmalloc(adj->size + 1);  // never empty
+    p = adj->bytes;
+    for (u = 0; u < graph->n; u++) {
+        nbr = u;
+        for (i = graph->index[u]; i < graph->index[u+1]; i++) {
+            p = writeVarint(p, zigzag((int64_t)graph->edges[i] - nbr));
+            nbr = graph->edges[i];
+        }
+    }
+    assert((size_t)(p - adj->bytes) == adj->size);
+    adj->dead = tcalloc(graph->m*2/64 + 1, sizeof(uint64_t));
+
+    // the plain array of a snapshot belongs to its mapping
+    if (graph->snapshot.data == NULL) free(graph->edges);
+    graph->edges = NULL;
+}
+
+void
+freePackedAdj(PackedAdj *adj)
+{   // free the packed rows, if any
+    free(adj->bytes);
+    free(adj->start);
+    free(adj->dead);
+    memset(adj, 0, sizeof(PackedAdj));
+}
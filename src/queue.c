@@ -1,8 +1,8 @@
 #include "graph.h"
 
 
-void initQueue(Queue *q, int size) {
-    q->data = tcalloc(size, sizeof(int));
+void initQueue(Queue *q, node_t size) {
+    q->data = tcalloc(size, sizeof(node_t));
     q->size = size;
     q->first = 0;
     q->last = size - 1;
@@ -17,7 +17,7 @@ void freeQueue(Queue *q) {
     free(q->data);
 }
 
-void enqueue(Queue *q, int x) {
+void enqueue(Queue *q, node_t x) {
     // double queue size if necessary
     if (q->count >= q->size) doubleQueueSize(q);
 
@@ -28,14 +28,22 @@ void enqueue(Queue *q, int x) {
 }
 
 void doubleQueueSize(Queue *q) {
+    node_t old = q->size;
     q->size *= 2;
-    q->data = realloc(q->data, q->size * sizeof(int));
+    q->data = trealloc(q->data, q->size * sizeof(node_t));
+
+    // a full queue that wraps around continues at the start of the
+    // array; move that part past the old end to keep it contiguous
+    if (q->count > 0 && q->last < q->first) {
+        memcpy(q->data + old, q->data, (q->last+1) * sizeof(node_t));
+        q->last += old;
+    }
 }
 
-int dequeue(Queue *q) {
+node_t dequeue(Queue *q) {
     assert(q->count > 0);
 
-    int item;
+    node_t item;
     item = q->data[q->first];
     q->first = (q->first+1) % q->size;
     q->count--;
@@ -49,13 +57,13 @@ int queueIsEmpty(Queue *q) {
 }
 
 void printQueue(Queue *q) {
-    int i = q->first;
+    node_t i = q->first;
 
     while (i != q->last) {
-        printf("%c ", q->data[i]);
+        printf("%" PRInode " ", q->data[i]);
         i = (i+1) % q->size;
     }
 
-    printf("%2d ",q->data[i]);
+    printf("%2" PRInode " ", q->data[i]);
     printf("\n");
 }
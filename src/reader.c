@@ -0,0 +1,442 @@
+#include "graph.h"
+
+
+// whitespace as defined by `isspace` in the C locale
+#define isSpace(c)  ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+#define isDigit(c)  ((unsigned)((c) - '0') < 10)
+
+int
+mapFile(const char *path, MappedFile *mf, int writable)
+{   // map the file at `path` into memory; return 0 on success, else -1
+    int fd;
+    struct stat st;
+
+    mf->data = NULL;
+    mf->size = 0;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // mmap refuses zero-length mappings; leave an empty file unmapped
+    if (st.st_size > 0) {
+        mf->data = mmap(NULL, st.st_size,
+                        writable ? PROT_READ|PROT_WRITE : PROT_READ,
+                        MAP_PRIVATE, fd, 0);
+        if (mf->data == MAP_FAILED) {
+            mf->data = NULL;
+            close(fd);
+            return -1;
+        }
+        mf->size = st.st_size;
+    }
+    close(fd);  // the mapping stays valid after the descriptor is closed
+    return 0;
+}
+
+void
+unmapFile(MappedFile *mf)
+{   // release a mapping created by `mapFile`
+    if (mf->data != NULL) munmap(mf->data, mf->size);
+    mf->data = NULL;
+    mf->size = 0;
+}
+
+// Scan a (possibly signed) decimal integer, skipping leading whitespace.
+// Return a pointer just past the last digit, or NULL if none was found.
+const char *
+scanInt(const char *p, const char *end, int64_t *val)
+{
+    uint64_t x = 0;
+    int neg = 0;
+
+    while (p < end && isSpace(*p)) p++;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+    if (p >= end || !isDigit(*p)) return NULL;
+
+    // accumulate unsigned so overflow wraps like `scanf` does in practice
+    do {
+        x = x*10 + (*p++ - '0');
+    } while (p < end && isDigit(*p));
+
+    *val = (int64_t)(neg ? 0u - x : x);
+    return p;
+}
+
+const char *
+skipComments(const char *p, const char *end)
+{   // skip whitespace and whole '#' or '%' comment lines
+    while (p < end) {
+        if (isSpace(*p)) {
+            p++;
+        } else if (*p == '#' || *p == '%') {
+            p = memchr(p, '\n', end - p);
+            if (p == NULL) return end;
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+// Scan up to `max` "i j" pairs into the `icol` and `jcol` arrays.
+// Return the number of pairs read; `*stop` is the first unconsumed byte.
+edge_t
+scanEdges(const char *p, const char *end, node_t *icol, node_t *jcol,
+          edge_t max, const char **stop)
+{
+    const char *q;
+    edge_t count = 0;
+    int64_t i, j;
+
+    while (count < max) {
+        p = skipComments(p, end);
+        if ((q = scanInt(p, end, &i)) == NULL) break;
+        if ((q = scanInt(q, end, &j)) == NULL) break;
+        if ((node_t)i != i || (node_t)j != j) {
+            fprintf(stderr, "node id %" PRId64 " does not fit in node_t; "
+                    "rebuild with NODES64=1\n", ((node_t)i != i) ? i : j);
+            error(BAD_INPUT);
+        }
+        icol[count] = (node_t)i;
+        jcol[count] = (node_t)j;
+        p = q;
+        count++;
+    }
+    *stop = p;
+    return count;
+}
+
+void *
+parseChunk(void *arg)
+{   // parse a whole chunk into its private columns
+    ParseChunk *chunk = (ParseChunk *)arg;
+    const char *p = chunk->start, *stop;
+
+    chunk->nodes[ICOL] = tmalloc(chunk->cap * sizeof(node_t));
+    chunk->nodes[JCOL] = tmalloc(chunk->cap * sizeof(node_t));
+    chunk->count = 0;
+    while (1) {
+        chunk->count += scanEdges(p, chunk->end,
+                                  chunk->nodes[ICOL] + chunk->count,
+                                  chunk->nodes[JCOL] + chunk->count,
+                                  chunk->cap - chunk->count, &stop);
+        p = stop;
+        if (chunk->count < chunk->cap) break;
+        if (chunk->cap > MAX_EDGES/2) {
+            fprintf(stderr, "too many edges in one input chunk\n");
+            error(BAD_INPUT);
+        }
+
+        // the size estimate was short; double the columns and keep going
+        chunk->cap *= 2;
+        chunk->nodes[ICOL] = trealloc(chunk->nodes[ICOL], chunk->cap * sizeof(node_t));
+        chunk->nodes[JCOL] = trealloc(chunk->nodes[JCOL], chunk->cap * sizeof(node_t));
+    }
+    chunk->stop = p;
+    return NULL;
+}
+
+void *
+storeChunk(void *arg)
+{   // copy a parsed chunk into its slice of the EdgeList
+    ParseChunk *chunk = (ParseChunk *)arg;
+    int col;
+
+    for (col = ICOL; col <= JCOL; col++) {
+        memcpy(chunk->elist->nodes[col] + chunk->offset, chunk->nodes[col],
+               chunk->count * sizeof(node_t));
+        free(chunk->nodes[col]);
+        chunk->nodes[col] = NULL;
+    }
+    return NULL;
+}
+
+// Split [p, end) into `num_chunks` newline-aligned chunks and parse them
+// in parallel into `elist`. Return the number of edges found; the edge
+// list is only filled in if that matches its length. If `expected` is
+// negative the edge count is unknown, and `elist` is allocated here to
+// fit. `*stop` is set to the first byte that could not be parsed.
+static edge_t
+parseInChunks(const char *p, const char *end, EdgeList *elist, int num_chunks,
+              edge_t expected, const char **stop)
+{
+    ParseChunk *chunks = tcalloc(num_chunks, sizeof(ParseChunk));
+    pthread_t *threads = tcalloc(num_chunks, sizeof(pthread_t));
+    size_t step = (end - p) / num_chunks;
+    const char *cut = p;
+    double estimate;
+    edge_t total = 0;
+    int c;
+
+    estimate = (expected >= 0) ? expected : (double)(end - p) / EDGE_BYTES_GUESS;
+
+    for (c = 0; c < num_chunks; c++) {
+        chunks[c].start = cut;
+        chunks[c].elist = elist;
+        if (c == num_chunks-1) {
+            cut = end;
+        } else {  // advance to the line break after the nominal boundary
+            cut = p + step*(c+1);
+            if (cut < chunks[c].start) cut = chunks[c].start;
+            cut = memchr(cut, '\n', end - cut);
+            cut = (cut == NULL) ? end : cut+1;
+        }
+        chunks[c].end = cut;
+
+        // size the private columns from this chunk's share of the edges
+        chunks[c].cap = (edge_t)(estimate * (cut - chunks[c].start)
+                                 / (end - p) * 1.1) + 16;
+        pthread_create(&threads[c], NULL, parseChunk, &chunks[c]);
+    }
+    for (c = 0; c < num_chunks; c++) {
+        pthread_join(threads[c], NULL);
+    }
+
+    // prefix sum over the per-chunk counts gives each slice's offset;
+    // a chunk that stopped short of its end hit something unparsable
+    *stop = end;
+    for (c = 0; c < num_chunks; c++) {
+        chunks[c].offset = total;
+        total += chunks[c].count;
+        if (*stop == end &&
+            skipComments(chunks[c].stop, chunks[c].end) != chunks[c].end) {
+            *stop = chunks[c].stop;
+        }
+    }
+    if (total > MAX_EDGES) {
+        fprintf(stderr, "%" PRIedge " edges do not fit in edge_t; "
+                "rebuild with EDGES64=1\n", total);
+        error(BAD_INPUT);
+    }
+    if (expected < 0) newEdgeList(elist, total);
+
+    // concatenate the slices; skip it if they would overrun the edge list
+    for (c = 0; c < num_chunks; c++) {
+        if (total == elist->length) {
+            pthread_create(&threads[c], NULL, storeChunk, &chunks[c]);
+        } else {
+            free(chunks[c].nodes[ICOL]);
+            free(chunks[c].nodes[JCOL]);
+        }
+    }
+    for (c = 0; c < num_chunks && total == elist->length; c++) {
+        pthread_join(threads[c], NULL);
+    }
+    free(threads);
+    free(chunks);
+    return total;
+}
+
+// Scan the "#nodes #edges" line at the start of the input, skipping any
+// comments before it. Return a pointer just past the header.
+const char *
+scanHeader(const char *p, const char *end, char *path, node_t *num_nodes,
+           edge_t *num_edges)
+{
+    int64_t n, m;
+
+    p = scanInt(skipComments(p, end), end, &n);
+    if (p != NULL) p = scanInt(p, end, &m);
+    if (p == NULL || n < 0 || m < 0) {
+        fprintf(stderr, "missing \"#nodes #edges\" header in %s\n", path);
+        error(BAD_INPUT);
+    }
+    if (n > NODE_MAX || m > MAX_EDGES) {
+        fprintf(stderr, "%s: %" PRId64 " nodes and %" PRId64 " edges need a "
+                "wider build; rebuild with %s=1\n", path, n, m,
+                (n > NODE_MAX) ? "NODES64" : "EDGES64");
+        error(BAD_INPUT);
+    }
+    *num_nodes = (node_t)n;
+    *num_edges = (edge_t)m;
+    return p;
+}
+
+// Fail unless only whitespace and comments are left in [stop, end).
+// Without a declared edge count this is the only way to notice that
+// parsing stopped early.
+void
+checkConsumed(const char *stop, const char *end, char *path)
+{
+    const char *nl;
+
+    stop = skipComments(stop, end);
+    if (stop != end) {
+        nl = memchr(stop, '\n', end - stop);
+        fprintf(stderr, "%s: cannot parse edge \"%.*s\"\n", path,
+                (int)((nl == NULL ? end : nl) - stop), stop);
+        error(BAD_INPUT);
+    }
+}
+
+// initial edge list length for `bytes` of input of unknown edge count
+static edge_t
+guessEdges(size_t bytes)
+{
+    size_t guess = bytes / EDGE_BYTES_GUESS + 16;
+    return (guess > MAX_EDGES/2) ? MAX_EDGES/2 : (edge_t)guess;
+}
+
+// Scan edges into `elist` from position `count` on, doubling the list
+// whenever it fills up. Return the new number of edges.
+static edge_t
+scanGrowing(const char *p, const char *end, EdgeList *elist, edge_t count,
+            const char **stop)
+{
+    while (1) {
+        count += scanEdges(p, end, elist->nodes[ICOL] + count,
+                           elist->nodes[JCOL] + count,
+                           elist->length - count, stop);
+        if (count < elist->length) return count;
+        p = *stop;
+        if (elist->length > MAX_EDGES/2 - 16) {
+            fprintf(stderr, "more than %" PRIedge " edges do not fit in edge_t; "
+                    "rebuild with EDGES64=1\n", elist->length);
+            error(BAD_INPUT);
+        }
+        resizeEdgeList(elist, elist->length*2 + 16);
+    }
+}
+
+// Parse a compressed or piped edgelist as the producer reads it. Blocks
+// end on line breaks, so each one is scanned on its own; with `stream`,
+// whose `elist` is `elist`, the ids of each block are interned before the
+// next one is waited for.
+static void
+readEdgeBlocks(char *path, int format, EdgeList *elist, node_t *num_nodes,
+               edge_t *num_edges, int headerless, StreamedEdges *stream)
+{
+    BlockRing ring;
+    StreamBlock *blk;
+    const char *p, *end, *stop;
+    edge_t count = 0;
+    int64_t extra;
+    int started = 0;
+
+    openBlockRing(&ring, path, format);
+    while ((blk = nextBlock(&ring)) != NULL) {
+        p = blk->data;
+        end = p + blk->len;
+
+        // size the edge list from the header, or guess and grow it
+        if (!started) {
+            if (headerless) {
+                *num_nodes = 0;  // not known until the ids are mapped
+                newEdgeList(elist, guessEdges(STREAM_BLOCK_SIZE));
+            } else {
+                p = scanHeader(p, end, path, num_nodes, num_edges);
+                newEdgeList(elist, *num_edges);
+            }
+            started = 1;
+        }
+
+        if (headerless) {
+            count = scanGrowing(p, end, elist, count, &stop);
+            checkConsumed(stop, end, path);
+        } else {
+            count += scanEdges(p, end, elist->nodes[ICOL] + count,
+                               elist->nodes[JCOL] + count,
+                               *num_edges - count, &stop);
+            if (scanInt(stop, end, &extra) != NULL) {
+                fprintf(stderr, "%s: header declares %" PRIedge " edges, "
+                        "but the file has more\n", path, *num_edges);
+                error(BAD_INPUT);
+            }
+        }
+        releaseBlock(&ring);
+        if (stream != NULL) internEdges(stream, count);
+    }
+
+    if (closeBlockRing(&ring) < 0) {
+        fprintf(stderr, "%s: %s\n", path, (format == FORMAT_STREAM)
+                ? "unreadable, corrupt or truncated input"
+                : "corrupt or truncated compressed input");
+        error(BAD_INPUT);
+    }
+    if (!started) {
+        fprintf(stderr, "%s: no input\n", path);
+        error(BAD_INPUT);
+    }
+    if (headerless) {
+        resizeEdgeList(elist, count);
+        *num_edges = count;
+    } else if (count != *num_edges) {
+        fprintf(stderr, "%s: header declares %" PRIedge " edges, "
+                "but the file has fewer\n", path, *num_edges);
+        error(BAD_INPUT);
+    }
+}
+
+void
+readEdgeListFile(char *path, EdgeList *elist, node_t *num_nodes,
+                 edge_t *num_edges, int num_threads, int headerless)
+{
+    MappedFile mf;
+    const char *p, *end, *stop;
+    edge_t count;
+    int64_t extra;
+    int num_chunks, format;
+
+    format = detectFormat(path);
+    if (format != FORMAT_PLAIN) {
+        readEdgeBlocks(path, format, elist, num_nodes, num_edges, headerless, NULL);
+        return;
+    }
+
+    if (mapFile(path, &mf, 0) < 0) {
+        fprintf(stderr, "Unable to open graph edgelist: %s", path);
+        error(BAD_FP);
+    }
+    if (mf.data != NULL) madvise(mf.data, mf.size, MADV_SEQUENTIAL);
+    p = mf.data;
+    end = mf.data + mf.size;
+
+    // the first line contains #nodes #edges, unless told otherwise
+    if (headerless) {
+        *num_nodes = 0;  // not known until the ids are mapped
+        *num_edges = -1;
+    } else {
+        p = scanHeader(p, end, path, num_nodes, num_edges);
+        newEdgeList(elist, *num_edges);
+    }
+
+    // use one thread per MIN_CHUNK_BYTES of input, up to `num_threads`
+    num_chunks = (end - p) / MIN_CHUNK_BYTES;
+    if (num_chunks > num_threads) num_chunks = num_threads;
+
+    if (num_chunks > 1) {
+        count = parseInChunks(p, end, elist, num_chunks, *num_edges, &stop);
+    } else if (headerless) {  // a single pass, growing the list as needed
+        newEdgeList(elist, guessEdges(end - p));
+        count = scanGrowing(p, end, elist, 0, &stop);
+        resizeEdgeList(elist, count);
+    } else {  // scan the edges directly into the edge list columns
+        count = scanEdges(p, end, elist->nodes[ICOL], elist->nodes[JCOL],
+                          *num_edges, &stop);
+    }
+
+    if (headerless) {
+        checkConsumed(stop, end, path);
+        *num_edges = count;
+    } else if (count != *num_edges || scanInt(stop, end, &extra) != NULL) {
+        fprintf(stderr, "%s: header declares %" PRIedge " edges, but the file has %s\n",
+                path, *num_edges, (count < *num_edges) ? "fewer" : "more");
+        error(BAD_INPUT);
+    }
+    unmapFile(&mf);
+}
+
+void
+readEdgeStream(char *path, StreamedEdges *stream, node_t *num_nodes,
+               edge_t *num_edges, int headerless)
+{   // read a piped edgelist, interning its ids as the blocks arrive
+    readEdgeBlocks(path, FORMAT_STREAM, &stream->elist, num_nodes, num_edges,
+                   headerless, stream);
+}
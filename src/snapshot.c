@@ -0,0 +1,286 @@
+#include "graph.h"
+
+
+int
+isSnapshotFile(char *path)
+{   // return 1 if the file at `path` is a binary CSR snapshot, else 0
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    int fd, found = 0;
+
+    if (isStreamInput(path)) return 0;  // reading the magic would eat it
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    if (read(fd, magic, sizeof(magic)) == sizeof(magic)) {
+        found = (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0);
+    }
+    close(fd);
+    return found;
+}
+
+int
+writeSection(FILE *fpout, int64_t offset, const void *data, size_t size,
+             const char *path)
+{   // write `size` bytes of `data` at `offset`, zero-padding up to it
+    int ok = 1;
+
+    while (ok && ftell(fpout) < offset) ok = (fputc(0, fpout) != EOF);
+    if (ok) ok = (fwrite(data, 1, size, fpout) == size);
+    if (ok) return 0;
+    if (path == NULL) return -1;
+    fprintf(stderr, "unable to write %s\n", path);
+    error(BAD_FP);
+}
+
+int64_t
+layoutSnapshot(SnapshotHeader *hdr, node_t n, edge_t m)
+{   // fill in the header of a snapshot of an n node, m edge graph, laying
+    // the sections out back to back, each on an aligned boundary; return
+    // the size of the file
+    int64_t size[SNAP_NUM_SECTIONS], offset;
+    int s;
+
+    memset(hdr, 0, sizeof(SnapshotHeader));
+    memcpy(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic));
+    hdr->version = SNAPSHOT_VERSION;
+    hdr->node_bytes = sizeof(node_t);
+    hdr->offset_bytes = sizeof(edge_t);
+    hdr->n = n;
+    hdr->m = m;
+
+    size[SNAP_ID] = n * sizeof(node_t);
+    size[SNAP_INDEX] = (n+1) * sizeof(edge_t);
+    size[SNAP_EDGES] = m*2 * sizeof(node_t);
+    size[SNAP_LOWER] = (n+1) * sizeof(edge_t);
+    size[SNAP_LOWER_ID] = m * sizeof(edge_t);
+
+    offset = sizeof(SnapshotHeader);
+    for (s = 0; s < SNAP_NUM_SECTIONS; s++) {
+        offset = alignSection(offset);
+        hdr->offset[s] = offset;
+        offset += size[s];
+    }
+    return offset;
+}
+
+void
+writeSnapshot(SparseUGraph *graph, char *path)
+{   // write the CSR arrays of a freshly read graph to a snapshot at `path`
+    assert(graph != NULL && graph->id != NULL);
+    assert(graph->packed.bytes == NULL);
+    SnapshotHeader hdr;
+    size_t size[SNAP_NUM_SECTIONS];
+    void *data[SNAP_NUM_SECTIONS];
+    FILE *fpout;
+    int s;
+
+    layoutSnapshot(&hdr, graph->n, graph->m);
+    data[SNAP_ID] = graph->id;
+    size[SNAP_ID] = graph->n * sizeof(node_t);
+    data[SNAP_INDEX] = graph->index;
+    size[SNAP_INDEX] = (graph->n+1) * sizeof(edge_t);
+    data[SNAP_EDGES] = graph->edges;
+    size[SNAP_EDGES] = graph->m*2 * sizeof(node_t);
+    data[SNAP_LOWER] = graph->lower;
+    size[SNAP_LOWER] = (graph->n+1) * sizeof(edge_t);
+    data[SNAP_LOWER_ID] = graph->lower_id;
+    size[SNAP_LOWER_ID] = graph->m * sizeof(edge_t);
+
+    fpout = fopen(path, "wb");
+    if (fpout == NULL) {
+        fprintf(stderr, "unable to open snapshot file: %s", path);
+        error(BAD_FP);
+    }
+    writeSection(fpout, 0, &hdr, sizeof(hdr), path);
+    for (s = 0; s < SNAP_NUM_SECTIONS; s++) {
+        writeSection(fpout, hdr.offset[s], data[s], size[s], path);
+    }
+    if (fclose(fpout) != 0) {
+        fprintf(stderr, "unable to write snapshot file: %s", path);
+        error(BAD_FP);
+    }
+}
+
+// Return 1 if the rows of a mapped snapshot form a CSR that `bfs` and
+// `cutEdge` can trust, else 0. Every row must hold distinct neighbors in
+// [0,n) in ascending order, none the node itself; `lower` must count the
+// neighbors below each node; and `lower_id` must give each lower half
+// (u, v) the id of the upper half (v, u) in row v. Runs in O(m log d).
+static int
+checkSnapshotRows(SparseUGraph *graph)
+{
+    node_t u, v;
+    edge_t i, lo, hi, mid, split;
+
+    if (graph->lower[0] != 0 || graph->lower[graph->n] != graph->m) return 0;
+    for (u = 0; u < graph->n; u++) {
+        if (graph->lower[u+1] < graph->lower[u]
+            || graph->lower[u+1] - graph->lower[u] > graph->index[u+1] - graph->index[u]) {
+            return 0;
+        }
+        split = graph->index[u] + lowerDegree(graph, u);
+        for (i = graph->index[u]; i < graph->index[u+1]; i++) {
+            v = graph->edges[i];
+            if (v < 0 || v >= graph->n || (i < split) != (v < u) || v == u
+                || (i > graph->index[u] && graph->edges[i-1] >= v)) {
+                return 0;
+            }
+        }
+    }
+    // every lower half now lies in a valid row; find its upper half
+    for (u = 0; u < graph->n; u++) {
+        split = graph->index[u] + lowerDegree(graph, u);
+        for (i = graph->index[u]; i < split; i++) {
+            v = graph->edges[i];
+            lo = graph->index[v] + lowerDegree(graph, v);
+            hi = graph->index[v+1];
+            while (lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if (graph->edges[mid] < u) lo = mid+1;
+                else hi = mid;
+            }
+            if (lo == graph->index[v+1] || graph->edges[lo] != u
+                || graph->lower_id[graph->lower[u] + i - graph->index[u]]
+                   != lo - graph->lower[v+1]) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void
+loadSnapshot(char *path, SparseUGraph *graph)
+{   // map a snapshot and point the CSR arrays of the graph into the mapping
+    SnapshotHeader *hdr;
+    MappedFile *mf = &graph->snapshot;
+    int64_t size[SNAP_NUM_SECTIONS];
+    node_t u;
+    int s, ok;
+
+    // Map privately and writably: cutting edges writes into `edges`,
+    // which copies only the touched pages and never changes the file.
+    if (mapFile(path, mf, 1) < 0) {
+        fprintf(stderr, "Unable to open graph snapshot: %s", path);
+        error(BAD_FP);
+    }
+    hdr = (SnapshotHeader *)mf->data;
+    if (mf->size < sizeof(SnapshotHeader)
+        || memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0) {
+        fprintf(stderr, "%s is not a graph snapshot\n", path);
+        error(BAD_INPUT);
+    }
+    if (hdr->version != SNAPSHOT_VERSION) {
+        fprintf(stderr, "%s: unsupported snapshot version %u\n",
+                path, hdr->version);
+        error(BAD_INPUT);
+    }
+    if (hdr->node_bytes != sizeof(node_t) || hdr->offset_bytes != sizeof(edge_t)) {
+        fprintf(stderr, "%s: snapshot has %u-byte node ids and %u-byte offsets, "
+                "but this build uses %zu and %zu (see NODES64/EDGES64)\n",
+                path, hdr->node_bytes, hdr->offset_bytes,
+                sizeof(node_t), sizeof(edge_t));
+        error(BAD_INPUT);
+    }
+    if (hdr->n < 0 || hdr->m < 0 || hdr->n >= NODE_MAX || hdr->m > MAX_EDGES) {
+        fprintf(stderr, "%s: truncated or corrupt snapshot\n", path);
+        error(BAD_INPUT);
+    }
+    size[SNAP_ID] = hdr->n * sizeof(node_t);
+    size[SNAP_INDEX] = (hdr->n+1) * sizeof(edge_t);
+    size[SNAP_EDGES] = hdr->m*2 * sizeof(node_t);
+    size[SNAP_LOWER] = (hdr->n+1) * sizeof(edge_t);
+    size[SNAP_LOWER_ID] = hdr->m * sizeof(edge_t);
+    for (s = 0; s < SNAP_NUM_SECTIONS; s++) {
+        if (hdr->offset[s] < (int64_t)sizeof(SnapshotHeader)
+            || hdr->offset[s] % SNAPSHOT_ALIGN != 0
+            || hdr->offset[s] > (int64_t)mf->size
+            || hdr->offset[s] + size[s] > (int64_t)mf->size) {
+            fprintf(stderr, "%s: truncated or corrupt snapshot\n", path);
+            error(BAD_INPUT);
+        }
+    }
+
+    graph->n = hdr->n;
+    graph->m = hdr->m;
+    graph->id = (node_t *)(mf->data + hdr->offset[SNAP_ID]);
+    graph->index = (edge_t *)(mf->data + hdr->offset[SNAP_INDEX]);
+    graph->edges = (node_t *)(mf->data + hdr->offset[SNAP_EDGES]);
+    graph->lower = (edge_t *)(mf->data + hdr->offset[SNAP_LOWER]);
+    graph->lower_id = (edge_t *)(mf->data + hdr->offset[SNAP_LOWER_ID]);
+
+    // every traversal trusts the row offsets: they must cover the slots
+    // exactly and never run backwards
+    ok = (graph->index[0] == 0 && graph->index[graph->n] == graph->m*2);
+    for (u = 0; u < graph->n && ok; u++) {
+        ok = (graph->index[u] <= graph->index[u+1]);
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: corrupt row offsets in snapshot\n", path);
+        error(BAD_INPUT);
+    }
+    if (!checkSnapshotRows(graph)) {
+        fprintf(stderr, "%s: corrupt rows in snapshot\n", path);
+        error(BAD_INPUT);
+    }
+
+    // the node id map is only needed while building the CSR
+    memset(&graph->idmap, 0, sizeof(graph->idmap));
+}
+
+int
+storeNodeIds(SparseUGraph *graph, char *near)
+{   // write the id array to an unlinked sidecar and map it in its place
+    IdsHeader hdr;
+    char *path;
+    const char *dir;
+    FILE *fpout = NULL;
+    int fd, ok;
+
+    assert(graph != NULL && graph->id_file.data == NULL);
+    if (graph->snapshot.data != NULL || graph->id == NULL || graph->n == 0) {
+        return 0;  // nothing on the heap to move
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, IDS_MAGIC, sizeof(hdr.magic));
+    hdr.version = IDS_VERSION;
+    hdr.node_bytes = sizeof(node_t);
+    hdr.n = graph->n;
+
+    // a fresh name per run, so that concurrent runs never share one
+    if (near != NULL) {
+        path = tmalloc(strlen(near) + sizeof(IDS_TEMPLATE));
+        sprintf(path, "%s" IDS_TEMPLATE, near);
+    } else {
+        dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0') dir = "/tmp";
+        path = tmalloc(strlen(dir) + sizeof("/comdetect") + sizeof(IDS_TEMPLATE));
+        sprintf(path, "%s/comdetect" IDS_TEMPLATE, dir);
+    }
+    fd = mkstemp(path);
+    ok = (fd >= 0);
+    if (ok) {
+        fpout = fdopen(fd, "wb");
+        ok = (fpout != NULL);
+        if (!ok) close(fd);
+    }
+    if (ok) {
+        ok = (writeSection(fpout, 0, &hdr, sizeof(hdr), NULL) == 0
+              && writeSection(fpout, alignSection(sizeof(hdr)), graph->id,
+                              graph->n * sizeof(node_t), NULL) == 0);
+        ok = (fclose(fpout) == 0 && ok);
+    }
+    if (ok) ok = (mapFile(path, &graph->id_file, 0) == 0);
+    if (fd >= 0) unlink(path);  // the mapping outlives the name
+    if (!ok) {
+        fprintf(stderr, "unable to write node id sidecar %s; keeping the "
+                "ids in memory\n", path);
+        free(path);
+        return -1;
+    }
+    free(path);
+
+    // the pages are only read back when the output is translated
+    free(graph->id);
+    graph->id = (node_t *)(graph->id_file.data + alignSection(sizeof(hdr)));
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include "graph.h"
+
+
+#define GZIP_MAGIC  "\x1f\x8b"
+#define ZSTD_MAGIC  "\x28\xb5\x2f\xfd"
+
+// decompressor state behind the producer thread
+typedef struct {
+
+    int format;
+    gzFile gz;          // FORMAT_GZIP
+#ifdef HAVE_ZSTD
+    FILE *fp;           // FORMAT_ZSTD: compressed input ...
+    ZSTD_DCtx *dctx;    // ... its decompression context ...
+    ZSTD_inBuffer in;   // ... and the compressed bytes not yet consumed
+    size_t pending;     // nonzero while a frame is incomplete
+#endif
+
+} Decoder;
+
+int
+isStreamInput(char *path)
+{   // return 1 if `path` is stdin or a pipe, which can only be read once
+    struct stat st;
+
+    if (strcmp(path, STDIN_PATH) == 0) return 1;
+    if (stat(path, &st) < 0) return 0;
+    return S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode) || S_ISCHR(st.st_mode);
+}
+
+int
+detectFormat(char *path)
+{   // return the format of the file at `path`, judging by its magic bytes
+    unsigned char magic[4];
+    int fd, format = FORMAT_PLAIN;
+
+    // peeking at a pipe would eat the bytes; zlib tells plain from gzip
+    // as it reads instead
+    if (isStreamInput(path)) return FORMAT_STREAM;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return FORMAT_PLAIN;
+    if (read(fd, magic, sizeof(magic)) == sizeof(magic)) {
+        if (memcmp(magic, GZIP_MAGIC, 2) == 0) format = FORMAT_GZIP;
+        else if (memcmp(magic, ZSTD_MAGIC, 4) == 0) format = FORMAT_ZSTD;
+    }
+    close(fd);
+    return format;
+}
+
+static int
+openDecoder(Decoder *dec, char *path, int format)
+{   // return 0 on success, else -1
+    int fd;
+
+    dec->format = format;
+    if (format == FORMAT_STREAM) {  // gzip, or plain text passed through
+        fd = (strcmp(path, STDIN_PATH) == 0) ? dup(STDIN_FILENO)
+                                             : open(path, O_RDONLY);
+        if (fd < 0) return -1;
+        dec->gz = gzdopen(fd, "rb");
+        if (dec->gz == NULL) {
+            close(fd);
+            return -1;
+        }
+        gzbuffer(dec->gz, 1 << 17);
+        return 0;
+    }
+    if (format == FORMAT_GZIP) {
+        dec->gz = gzopen(path, "rb");
+        if (dec->gz == NULL) return -1;
+        gzbuffer(dec->gz, 1 << 17);
+        return 0;
+    }
+#ifdef HAVE_ZSTD
+    if (format == FORMAT_ZSTD) {
+        dec->fp = fopen(path, "rb");
+        if (dec->fp == NULL) return -1;
+        dec->dctx = ZSTD_createDCtx();
+        dec->in.src = tmalloc(ZSTD_DStreamInSize());
+        dec->in.size = dec->in.pos = 0;
+        dec->pending = 0;
+        return 0;
+    }
+#endif
+    fprintf(stderr, "%s: compressed with an unsupported format%s\n", path,
+            (format == FORMAT_ZSTD) ? " (rebuild with ZSTD=1 for zstd)" : "");
+    return -1;
+}
+
+// Decompress up to `len` bytes into `buf`. Return the number of bytes
+// produced (0 at the end of the input), or -1 on corrupt input.
+static long
+readDecoder(Decoder *dec, char *buf, size_t len)
+{
+    long got;
+    int err;
+#ifdef HAVE_ZSTD
+    ZSTD_outBuffer out = {buf, len, 0};
+    size_t in_len;
+
+    if (dec->format == FORMAT_ZSTD) {
+        while (out.pos < out.size) {
+            if (dec->in.pos == dec->in.size) {
+                in_len = fread((void *)dec->in.src, 1, ZSTD_DStreamInSize(), dec->fp);
+                if (in_len == 0) {  // end of input: every frame must be complete
+                    if (ferror(dec->fp) || dec->pending != 0) return -1;
+                    break;
+                }
+                dec->in.size = in_len;
+                dec->in.pos = 0;
+            }
+            dec->pending = ZSTD_decompressStream(dec->dctx, &out, &dec->in);
+            if (ZSTD_isError(dec->pending)) return -1;
+        }
+        return (long)out.pos;
+    }
+#endif
+    got = gzread(dec->gz, buf, (unsigned)len);
+    if (got == 0) {  // truncated streams end with an error, not a clean eof
+        gzerror(dec->gz, &err);
+        if (err != Z_OK) return -1;
+    }
+    return got;
+}
+
+static void
+closeDecoder(Decoder *dec)
+{
+    if (dec->format == FORMAT_GZIP || dec->format == FORMAT_STREAM) {
+        gzclose(dec->gz);
+        return;
+    }
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(dec->dctx);
+    free((void *)dec->in.src);
+    fclose(dec->fp);
+#endif
+}
+
+// Producer thread: fill free slots with decompressed input, ending each
+// block after its last line break and carrying the rest to the next one.
+static void *
+produceBlocks(void *arg)
+{
+    BlockRing *ring = (BlockRing *)arg;
+    StreamBlock *blk;
+    Decoder dec;
+    char *carry, *nl;
+    size_t len, carry_len = 0;
+    long got;
+    int slot = 0, eof = 0, failed = 0;
+
+    if (openDecoder(&dec, ring->path, ring->format) < 0) {
+        pthread_mutex_lock(&ring->lock);
+        ring->failed = ring->done = 1;
+        pthread_cond_signal(&ring->filled);
+        pthread_mutex_unlock(&ring->lock);
+        return NULL;
+    }
+    carry = tmalloc(STREAM_BLOCK_SIZE);
+
+    while (!eof) {
+        pthread_mutex_lock(&ring->lock);
+        while (ring->count == STREAM_RING_SLOTS) {
+            pthread_cond_wait(&ring->released, &ring->lock);
+        }
+        pthread_mutex_unlock(&ring->lock);
+
+        // the slot is ours until it is queued
+        blk = &ring->slots[slot];
+        memcpy(blk->data, carry, carry_len);
+        len = carry_len;
+        while (len < STREAM_BLOCK_SIZE) {
+            got = readDecoder(&dec, blk->data + len, STREAM_BLOCK_SIZE - len);
+            if (got <= 0) {
+                failed = (got < 0);
+                eof = 1;
+                break;
+            }
+            len += got;
+        }
+
+        carry_len = 0;
+        if (!eof) {
+            nl = memrchr(blk->data, '\n', len);
+            if (nl == NULL) {  // a single line longer than a whole block
+                failed = eof = 1;
+            } else {
+                carry_len = blk->data + len - (nl+1);
+                memcpy(carry, nl+1, carry_len);
+                len -= carry_len;
+            }
+        }
+        blk->len = len;
+
+        pthread_mutex_lock(&ring->lock);
+        ring->count++;
+        ring->failed = failed;
+        ring->done = eof;
+        pthread_cond_signal(&ring->filled);
+        pthread_mutex_unlock(&ring->lock);
+        slot = (slot+1) % STREAM_RING_SLOTS;
+    }
+    free(carry);
+    closeDecoder(&dec);
+    return NULL;
+}
+
+void
+openBlockRing(BlockRing *ring, char *path, int format)
+{   // start a producer thread decompressing the file at `path` into the ring
+    int s;
+
+    for (s = 0; s < STREAM_RING_SLOTS; s++) {
+        ring->slots[s].data = tmalloc(STREAM_BLOCK_SIZE);
+        ring->slots[s].len = 0;
+    }
+    ring->head = ring->count = 0;
+    ring->done = ring->failed = 0;
+    ring->path = path;
+    ring->format = format;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->filled, NULL);
+    pthread_cond_init(&ring->released, NULL);
+    pthread_create(&ring->producer, NULL, produceBlocks, ring);
+}
+
+StreamBlock *
+nextBlock(BlockRing *ring)
+{   // wait for the next block; return NULL once the input is exhausted or
+    // turns out to be corrupt
+    StreamBlock *blk = NULL;
+
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == 0 && !ring->done) {
+        pthread_cond_wait(&ring->filled, &ring->lock);
+    }
+    if (ring->count > 0 && !ring->failed) blk = &ring->slots[ring->head];
+    pthread_mutex_unlock(&ring->lock);
+    return blk;
+}
+
+void
+releaseBlock(BlockRing *ring)
+{   // hand the block returned by `nextBlock` back to the producer
+    pthread_mutex_lock(&ring->lock);
+    ring->head = (ring->head+1) % STREAM_RING_SLOTS;
+    ring->count--;
+    pthread_cond_signal(&ring->released);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+int
+closeBlockRing(BlockRing *ring)
+{   // join the producer and free the ring; call only once drained
+    int s;
+
+    pthread_join(ring->producer, NULL);
+    for (s = 0; s < STREAM_RING_SLOTS; s++) {
+        free(ring->slots[s].data);
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->filled);
+    pthread_cond_destroy(&ring->released);
+    return ring->failed ? -1 : 0;
+}
@@ -1,5 +1,8 @@
 #include "graph.h"
 
+// calls to the allocation wrappers, see `getHeapStats`
+static HeapStats heap_stats;
+
 // print error and exit
 void error(int err_code)
 {
@@ -18,6 +21,7 @@ void *
 tcalloc(size_t nitems, size_t size)
 {
     void *block;
+    __atomic_fetch_add(&heap_stats.tcalloc_calls, 1, __ATOMIC_RELAXED);
     block = calloc(nitems, size);
     if (block == NULL) {
         block = calloc(nitems, size);  // try one more time
@@ -31,6 +35,7 @@ void *
 tmalloc(size_t size)
 {
     void *block;
+    __atomic_fetch_add(&heap_stats.tmalloc_calls, 1, __ATOMIC_RELAXED);
     block= malloc(size);
     if (block == NULL) {
         block = malloc(size);  // try one more time
@@ -43,6 +48,7 @@ tmalloc(size_t size)
 void *
 trealloc(void *ptr, size_t size)
 {
+    __atomic_fetch_add(&heap_stats.trealloc_calls, 1, __ATOMIC_RELAXED);
     ptr = realloc(ptr, size);
     if (ptr == NULL) {
         ptr = realloc(ptr, size);  // try one more time
@@ -51,63 +57,202 @@ trealloc(void *ptr, size_t size)
     return ptr;
 }
 
+char *
+tempPathFor(char *path)
+{   // `path` plus the pid and a count of the calls made so far
+    static unsigned long calls;
+    unsigned long call = __atomic_fetch_add(&calls, 1, __ATOMIC_RELAXED);
+    char *tmp = tmalloc(strlen(path) + 48);
+
+    sprintf(tmp, "%s.%d.%lu", path, (int)getpid(), call);
+    return tmp;
+}
+
+void
+getHeapStats(HeapStats *stats)
+{
+    stats->tcalloc_calls = __atomic_load_n(&heap_stats.tcalloc_calls, __ATOMIC_RELAXED);
+    stats->tmalloc_calls = __atomic_load_n(&heap_stats.tmalloc_calls, __ATOMIC_RELAXED);
+    stats->trealloc_calls = __atomic_load_n(&heap_stats.trealloc_calls, __ATOMIC_RELAXED);
+}
+
 // find the largest number in the array
-int findLargest(int *array, int length)
+node_t findLargest(node_t *array, edge_t length)
 {
-    int i, largest = -1;
+    edge_t i;
+    node_t largest = -1;
     for (i = 0; i < length; i++) {
         if (array[i] > largest) largest = array[i];
     }
     return largest;
 }
 
-// perform an in-place radix sort on the array; result is ascending order
-void radixSort(int *array, int length)
-{
-    // Base 10 is used
-    int i;
-    int base = 10;        /* base 10 is used */
-    int sig_digit = 1;    /* most significant digit */
-    int bucket[base];     /* need one bucket for each of 0-base modulus results */
-    int largest = findLargest(array, length);
-    int *semi_sorted = tcalloc(length, sizeof(int));
-
-    // Loop until we reach the largest significant digit
-    while ((largest / sig_digit) > 0) {
-        memset(bucket, 0, sizeof(bucket));
-
-        // Counts the number of "keys" or digits that will go into each bucket
-        for (i = 0; i < length; i++) {
-            bucket[(array[i] / sig_digit) % base]++;
-        }
+// digit `shift` of a key, with the sign bit flipped so that negative
+// keys order before positive ones
+#ifdef NODES64
+#define radixDigit(key, shift) \
+    ((((uint64_t)(key) ^ 0x8000000000000000u) >> (shift)) & (RADIX_BUCKETS-1))
+#else
+#define radixDigit(key, shift) \
+    ((((uint32_t)(key) ^ 0x80000000u) >> (shift)) & (RADIX_BUCKETS-1))
+#endif
 
-        // Add the count of the previous buckets.
-        // This acquires the indices after the end of each bucket location in
-        // the edge list -- similar to count sorting algorithm.
-        for (i = 1; i < base; i++) {
-            bucket[i] += bucket[i-1];
-        }
+// Histogram the current digit over one slice of the source buffer
+static void *
+radixCount(void *arg)
+{
+    RadixSlice *slice = (RadixSlice *)arg;
+    node_t *keys = slice->sort->keys[slice->sort->src];
+    edge_t i;
+    int shift = slice->sort->shift;
 
-        // Use the bucket to fill a "semi_sorted" array
-        for (i = length-1; i >= 0; i--) {
-            semi_sorted[--bucket[(array[i] / sig_digit) % base]] = array[i];
-        }
+    memset(slice->count, 0, sizeof(slice->count));
+    for (i = slice->start; i < slice->end; i++) {
+        slice->count[radixDigit(keys[i], shift)]++;
+    }
+    return NULL;
+}
 
-        for (i = 0; i < length; i++) {
-            array[i] = semi_sorted[i];
+// Move one slice from the source to the destination buffer; `count`
+// holds the slice's first destination index for each digit.
+static void *
+radixScatter(void *arg)
+{
+    RadixSlice *slice = (RadixSlice *)arg;
+    RadixSort *sort = slice->sort;
+    int src = sort->src, dst = 1 - sort->src;
+    node_t *keys = sort->keys[src];
+    edge_t i, loc;
+    int shift = sort->shift;
+
+    for (i = slice->start; i < slice->end; i++) {
+        loc = slice->count[radixDigit(keys[i], shift)]++;
+        sort->keys[dst][loc] = keys[i];
+        if (sort->vals1[src] != NULL) sort->vals1[dst][loc] = sort->vals1[src][i];
+        if (sort->vals2[src] != NULL) sort->vals2[dst][loc] = sort->vals2[src][i];
+    }
+    return NULL;
+}
+
+// run `fn` on every slice, on its own thread when there is more than one
+static void
+radixRun(RadixSort *sort, void *(*fn)(void *))
+{
+    pthread_t threads[RADIX_MAX_THREADS];
+    int t;
+
+    if (sort->num_slices == 1) {
+        fn(&sort->slices[0]);
+        return;
+    }
+    for (t = 0; t < sort->num_slices; t++) {
+        pthread_create(&threads[t], NULL, fn, &sort->slices[t]);
+    }
+    for (t = 0; t < sort->num_slices; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+// Sort `keys` in ascending order, permuting the (optional, may be NULL)
+// payload arrays `vals1` and `vals2` along with them. The sort is a
+// stable LSD radix sort on 8-bit digits: each pass histograms its digit
+// per thread, skips the pass if the digit is the same for every key, and
+// otherwise scatters into the other of two ping-pong buffers.
+void
+radixSortKeys(node_t *keys, node_t *vals1, edge_t *vals2, edge_t length)
+{
+    radixSortKeysIn(keys, vals1, vals2, length, NULL);
+}
+
+// `size` bytes for a spare buffer: from `scratch`, or the heap if NULL
+static void *
+radixSpare(Arena *scratch, size_t size)
+{
+    return (scratch != NULL) ? arenaAlloc(scratch, size) : tmalloc(size);
+}
+
+void
+radixSortKeysIn(node_t *keys, node_t *vals1, edge_t *vals2, edge_t length,
+                Arena *scratch)
+{
+    RadixSort sort;
+    int d, t, b, num_threads;
+    edge_t pos, total;
+
+    if (length < 2) return;
+
+    // only split arrays large enough to repay the thread start-up
+    num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads > RADIX_MAX_THREADS) num_threads = RADIX_MAX_THREADS;
+    if (num_threads > length / RADIX_MIN_SLICE) num_threads = (int)(length / RADIX_MIN_SLICE);
+    if (num_threads < 1) num_threads = 1;
+
+    sort.num_slices = num_threads;
+    for (t = 0; t < num_threads; t++) {
+        sort.slices[t].sort = &sort;
+        sort.slices[t].start = (edge_t)((int64_t)length * t / num_threads);
+        sort.slices[t].end = (edge_t)((int64_t)length * (t+1) / num_threads);
+    }
+
+    sort.src = 0;
+    sort.keys[0] = keys;
+    sort.vals1[0] = vals1;
+    sort.vals2[0] = vals2;
+    sort.keys[1] = radixSpare(scratch, length * sizeof(node_t));
+    sort.vals1[1] = (vals1 != NULL) ? radixSpare(scratch, length * sizeof(node_t)) : NULL;
+    sort.vals2[1] = (vals2 != NULL) ? radixSpare(scratch, length * sizeof(edge_t)) : NULL;
+
+    for (d = 0; d < RADIX_DIGITS; d++) {
+        sort.shift = d * RADIX_BITS;
+        radixRun(&sort, radixCount);
+
+        // Turn the per-thread counts into destination offsets: bucket by
+        // bucket, each thread's share follows the previous thread's. A
+        // digit shared by all keys leaves the order unchanged, so skip it.
+        pos = 0;
+        for (b = 0; b < RADIX_BUCKETS; b++) {
+            total = 0;
+            for (t = 0; t < num_threads; t++) {
+                total += sort.slices[t].count[b];
+            }
+            if (total == length) break;
+            for (t = 0; t < num_threads; t++) {
+                total = sort.slices[t].count[b];
+                sort.slices[t].count[b] = pos;
+                pos += total;
+            }
         }
+        if (b < RADIX_BUCKETS) continue;
 
-        // Move to next significant digit
-        sig_digit *= base;
+        radixRun(&sort, radixScatter);
+        sort.src = 1 - sort.src;
     }
-    free(semi_sorted);
+
+    // after an odd number of passes the result is in the spare buffers
+    if (sort.src == 1) {
+        memcpy(keys, sort.keys[1], length * sizeof(node_t));
+        if (vals1 != NULL) memcpy(vals1, sort.vals1[1], length * sizeof(node_t));
+        if (vals2 != NULL) memcpy(vals2, sort.vals2[1], length * sizeof(edge_t));
+    }
+    if (scratch == NULL) {
+        free(sort.keys[1]);
+        free(sort.vals1[1]);
+        free(sort.vals2[1]);
+    }
+}
+
+// perform an in-place radix sort on the array; result is ascending order
+void radixSort(node_t *array, edge_t length)
+{
+    radixSortKeys(array, NULL, NULL, length);
 }
 
 // remove all duplicate values from the integer array
 // return the size of the new array
-void removeDuplicates(int *a, int *length)
+void removeDuplicates(node_t *a, edge_t *length)
 {
-    int i, cur = 0;
+    edge_t i, cur = 0;
+    if (*length == 0) return;
     radixSort(a, *length);
     for (i = 1; i < *length; i++) {
         if (a[cur] != a[i]) {
@@ -117,12 +262,22 @@ void removeDuplicates(int *a, int *length)
     *length = cur + 1;  // new array size
 }
 
-// print an array of integers
-void printArray(int *array, int length)
+// print an array of node ids
+void printArray(node_t *array, edge_t length)
+{
+    edge_t i;
+    for (i = 0; i < length; i++) {
+        printf("%" PRInode " ", array[i]);
+    }
+    printf("\n");
+}
+
+// print an array of offsets or edge ids
+void printOffsets(edge_t *array, edge_t length)
 {
-    int i;
+    edge_t i;
     for (i = 0; i < length; i++) {
-        printf("%d ", array[i]);
+        printf("%" PRIedge " ", array[i]);
     }
     printf("\n");
 }
@@ -2,9 +2,9 @@
 
 
 void
-initVector(Vector *vec, int size)
+initVector(Vector *vec, edge_t size)
 {   // allocate space for new vector, with non-default initial size
-    vec->data = tcalloc(size, sizeof(int));
+    vec->data = tcalloc(size, sizeof(edge_t));
     vec->cap = size;
     vec->size = 0;
 }
@@ -26,16 +26,16 @@ freeVector(Vector *vec)
 }
 
 void
-vectorAppend(Vector *vec, int item)
+vectorAppend(Vector *vec, edge_t item)
 {   // append item to end of vector, expanding if necessary
     if (vec->size >= vec->cap) doubleVectorCap(vec);
     vec->data[vec->size++] = item;
 }
 
-int
+edge_t
 vectorPop(Vector *vec)
 {   // pop an item from the vector; don't call on empty vectors
-    int item;
+    edge_t item;
     //if (vec->size <= 0) error(EMPTY_VECTOR);
     assert(vec->size > 0);
     item = vec->data[--vec->size];
@@ -46,23 +46,39 @@ void
 doubleVectorCap(Vector *vec)
 {   // double capacity of vector
     vec->cap *= 2;
-    vec->data = (int *)trealloc(vec->data, vec->cap*sizeof(int));
+    vec->data = (edge_t *)trealloc(vec->data, vec->cap*sizeof(edge_t));
 }
 
-// remove all duplicate elements from the vector
+static int
+compareItems(const void *a, const void *b)
+{
+    edge_t x = *(const edge_t *)a, y = *(const edge_t *)b;
+    return (x > y) - (x < y);
+}
+
+// remove all duplicate elements from the vector (which sorts it)
 void
 uniqueVector(Vector *vec)
 {
     assert(vec->data != NULL);
-    removeDuplicates(vec->data, &vec->size);
+    edge_t i, cur = 0;
+
+    if (vec->size == 0) return;
+    qsort(vec->data, vec->size, sizeof(edge_t), compareItems);
+    for (i = 1; i < vec->size; i++) {
+        if (vec->data[cur] != vec->data[i]) {
+            vec->data[++cur] = vec->data[i];
+        }
+    }
+    vec->size = cur + 1;
 }
 
 void printVector(Vector *vec)
 {   // print full vector contents
     assert(vec != NULL);
-    int i;
+    edge_t i;
     for (i = 0; i < vec->size; i++) {
-        printf("%d ", vec->data[i]);
+        printf("%" PRIedge " ", vec->data[i]);
     }
     printf("\n");
 }
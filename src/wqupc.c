@@ -11,12 +11,12 @@
 #include "graph.h"
 
 
-UnionFind * uf_create(int size) {
+UnionFind * uf_create(node_t size) {
     /* Create a new UnionFind struct */
-    int i;
-    UnionFind *uf = calloc(1, sizeof(UnionFind));
-    uf->nodes = calloc(size, sizeof(int));
-    uf->sizes = calloc(size, sizeof(int));
+    node_t i;
+    UnionFind *uf = tcalloc(1, sizeof(UnionFind));
+    uf->nodes = tcalloc(size, sizeof(node_t));
+    uf->sizes = tcalloc(size, sizeof(node_t));
     uf->size = size;
 
     // initialize all node ids to their indices
@@ -35,7 +35,7 @@ void uf_destroy(UnionFind *uf) {
     free(uf);
 }
 
-int uf_root(UnionFind *uf, int id) {
+node_t uf_root(UnionFind *uf, node_t id) {
     /* Return the root of node n. */
     if (id >= uf->size) {
         printf("indices out of bounds in `uf_root`\n");
@@ -48,16 +48,17 @@ int uf_root(UnionFind *uf, int id) {
     return id;
 }
 
-void uf_union(UnionFind *uf, int n1, int n2) {
+void uf_union(UnionFind *uf, node_t n1, node_t n2) {
     /* Join the two nodes together.
      * This implementation is O(lgn).
      */
-    int i, root1, root2;
+    node_t root1, root2;
     if (n1 >= uf->size || n2 >= uf->size) {
         return;
     }
     root1 = uf_root(uf, n1);
     root2 = uf_root(uf, n2);
+    if (root1 == root2) return;  // already joined; don't count the tree twice
 
     // change root of shorter tree to root of taller
     if (uf->sizes[root1] > uf->sizes[root2]) {  // 1st tree taller than 2nd
@@ -69,7 +70,7 @@ void uf_union(UnionFind *uf, int n1, int n2) {
     }
 }
 
-int uf_find(UnionFind *uf, int n1, int n2) {
+int uf_find(UnionFind *uf, node_t n1, node_t n2) {
     /* Return 1 if the two nodes are connected, else 0.
      * This implementation is O(lgn).
      */
@@ -81,9 +82,9 @@ int uf_find(UnionFind *uf, int n1, int n2) {
 
 void uf_print(UnionFind *uf) {
     /* Print out the nodes of the UnionFind data structure. */
-    int i;
+    node_t i;
     for (i = 0; i < uf->size; i++) {
-        printf("%d", uf->nodes[i]);
+        printf("%" PRInode, uf->nodes[i]);
         if (i < uf->size-1) {
             printf(" ");
         }
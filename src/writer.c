@@ -0,0 +1,246 @@
+#include "graph.h"
+
+
+char *
+formatInt(char *p, int64_t val)
+{   // format `val` in decimal at `p`; return the byte after it
+    char digits[20], *d = digits;
+    uint64_t x = (uint64_t)val;
+
+    if (val < 0) {
+        *p++ = '-';
+        x = 0 - x;  // also right for INT64_MIN
+    }
+    do {
+        *d++ = '0' + (char)(x % 10);
+        x /= 10;
+    } while (x > 0);
+    while (d > digits) *p++ = *--d;
+    return p;
+}
+
+// write all of `buf`, retrying short writes
+static void
+writeAll(int fd, const char *buf, size_t len, char *path)
+{
+    ssize_t done;
+
+    while (len > 0) {
+        done = write(fd, buf, len);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) {
+            fprintf(stderr, "unable to write output file: %s\n", path);
+            error(BAD_FP);
+        }
+        buf += done;
+        len -= done;
+    }
+}
+
+// format the lines of one chunk into its buffer
+static void *
+formatChunk(void *arg)
+{
+    WriterSlice *slice = (WriterSlice *)arg;
+    CommWriter *w = slice->writer;
+    node_t c, lo, hi, mid;
+    edge_t line, j;
+    char *p = slice->buf;
+
+    // community holding the first line: last one starting at or before it
+    lo = 0;
+    hi = w->k - 1;
+    while (lo < hi) {
+        mid = lo + (hi - lo + 1) / 2;
+        if (w->start[mid] <= slice->first) lo = mid;
+        else hi = mid - 1;
+    }
+    c = lo;
+    j = slice->first - w->start[c];
+
+    for (line = slice->first; line < slice->last; line++, j++) {
+        while (j == w->comms[c].size) {  // skips empty communities too
+            c++;
+            j = 0;
+        }
+        p = formatInt(p, w->idmap[w->comms[c].data[j]]);
+        *p++ = ' ';
+        p = formatInt(p, c);
+        *p++ = '\n';
+    }
+    slice->len = p - slice->buf;
+    return NULL;
+}
+
+// format the chunks of a round, each on its own thread if there are more
+static void
+formatRound(CommWriter *w, int num_chunks)
+{
+    pthread_t threads[WRITER_MAX_THREADS];
+    int t;
+
+    if (num_chunks == 1) {
+        formatChunk(&w->slices[0]);
+        return;
+    }
+    for (t = 0; t < num_chunks; t++) {
+        pthread_create(&threads[t], NULL, formatChunk, &w->slices[t]);
+    }
+    for (t = 0; t < num_chunks; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+void
+writeCommunities(node_t *idmap, Vector *comms, node_t k, char *outfile,
+                 int num_threads)
+{   // write "<id> <community>" lines for every member of every community
+    CommWriter w;
+    edge_t num_lines, line;
+    node_t i;
+    int fd, t, num_chunks;
+
+    fd = open(outfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "unable to open output file: %s", outfile);
+        error(BAD_FP);
+    }
+
+    w.idmap = idmap;
+    w.comms = comms;
+    w.k = k;
+    w.start = tmalloc((k+1) * sizeof(edge_t));
+    w.start[0] = 0;
+    for (i = 0; i < k; i++) {
+        w.start[i+1] = w.start[i] + comms[i].size;
+    }
+    num_lines = w.start[k];
+
+    // only use as many threads as there are chunks to format
+    if (num_threads > WRITER_MAX_THREADS) num_threads = WRITER_MAX_THREADS;
+    if (num_threads > (num_lines + WRITER_CHUNK_LINES-1) / WRITER_CHUNK_LINES) {
+        num_threads = (int)((num_lines + WRITER_CHUNK_LINES-1) / WRITER_CHUNK_LINES);
+    }
+    if (num_threads < 1) num_threads = 1;
+    w.num_slices = num_threads;
+    for (t = 0; t < num_threads; t++) {
+        w.slices[t].writer = &w;
+        w.slices[t].buf = tmalloc(WRITER_CHUNK_LINES * WRITER_LINE_BYTES);
+    }
+
+    for (line = 0; line < num_lines; ) {
+        for (num_chunks = 0; num_chunks < num_threads && line < num_lines; num_chunks++) {
+            w.slices[num_chunks].first = line;
+            line += (num_lines - line < WRITER_CHUNK_LINES)
+                    ? num_lines - line : WRITER_CHUNK_LINES;
+            w.slices[num_chunks].last = line;
+        }
+        formatRound(&w, num_chunks);
+        for (t = 0; t < num_chunks; t++) {
+            writeAll(fd, w.slices[t].buf, w.slices[t].len, outfile);
+        }
+    }
+
+    for (t = 0; t < num_threads; t++) {
+        free(w.slices[t].buf);
+    }
+    free(w.start);
+    if (close(fd) < 0) {
+        fprintf(stderr, "unable to write output file: %s\n", outfile);
+        error(BAD_FP);
+    }
+}
+
+void
+writeLabels(node_t *idmap, node_t n, Vector *comms, node_t k, char *path)
+{   // write the labels file of the communities at `path`
+    LabelsHeader hdr;
+    uint32_t *label;
+    FILE *fpout;
+    node_t i;
+    edge_t j;
+
+    if ((uint64_t)k >= NO_LABEL) {
+        fprintf(stderr, "%" PRInode " communities do not fit uint32 labels\n", k);
+        error(BAD_INPUT);
+    }
+    label = tmalloc(n * sizeof(uint32_t));
+    memset(label, 0xff, n * sizeof(uint32_t));  // NO_LABEL
+    for (i = 0; i < k; i++) {
+        for (j = 0; j < comms[i].size; j++) {
+            label[comms[i].data[j]] = (uint32_t)i;
+        }
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LABELS_MAGIC, sizeof(hdr.magic));
+    hdr.version = LABELS_VERSION;
+    hdr.node_bytes = sizeof(node_t);
+    hdr.label_bytes = sizeof(uint32_t);
+    hdr.n = n;
+    hdr.k = k;
+    hdr.offset[LABELS_ID] = alignSection(sizeof(hdr));
+    hdr.offset[LABELS_LABEL] = alignSection(hdr.offset[LABELS_ID] + n * sizeof(node_t));
+
+    fpout = fopen(path, "wb");
+    if (fpout == NULL) {
+        fprintf(stderr, "unable to open labels file: %s", path);
+        error(BAD_FP);
+    }
+    writeSection(fpout, 0, &hdr, sizeof(hdr), path);
+    writeSection(fpout, hdr.offset[LABELS_ID], idmap, n * sizeof(node_t), path);
+    writeSection(fpout, hdr.offset[LABELS_LABEL], label, n * sizeof(uint32_t), path);
+    if (fclose(fpout) != 0) {
+        fprintf(stderr, "unable to write labels file: %s\n", path);
+        error(BAD_FP);
+    }
+    free(label);
+}
+
+void
+mapLabelsFile(char *path, LabelsFile *lf)
+{   // map a labels file and point `id` and `label` into the mapping
+    LabelsHeader *hdr;
+
+    if (mapFile(path, &lf->mf, 0) < 0) {
+        fprintf(stderr, "Unable to open labels file: %s", path);
+        error(BAD_FP);
+    }
+    hdr = (LabelsHeader *)lf->mf.data;
+    if (lf->mf.size < sizeof(LabelsHeader)
+        || memcmp(hdr->magic, LABELS_MAGIC, sizeof(hdr->magic)) != 0) {
+        fprintf(stderr, "%s is not a labels file\n", path);
+        error(BAD_INPUT);
+    }
+    if (hdr->version != LABELS_VERSION) {
+        fprintf(stderr, "%s: unsupported labels version %u\n", path, hdr->version);
+        error(BAD_INPUT);
+    }
+    if (hdr->node_bytes != sizeof(node_t) || hdr->label_bytes != sizeof(uint32_t)) {
+        fprintf(stderr, "%s: labels file has %u-byte node ids, but this build "
+                "uses %zu (see NODES64)\n", path, hdr->node_bytes, sizeof(node_t));
+        error(BAD_INPUT);
+    }
+    if (hdr->n < 0 || hdr->n >= NODE_MAX || hdr->k < 0 || hdr->k >= NO_LABEL
+        || hdr->offset[LABELS_ID] < (int64_t)sizeof(LabelsHeader)
+        || hdr->offset[LABELS_LABEL] < (int64_t)sizeof(LabelsHeader)
+        || hdr->offset[LABELS_ID] > (int64_t)lf->mf.size
+        || hdr->offset[LABELS_LABEL] > (int64_t)lf->mf.size
+        || hdr->offset[LABELS_ID] + hdr->n * sizeof(node_t) > lf->mf.size
+        || hdr->offset[LABELS_LABEL] + hdr->n * sizeof(uint32_t) > lf->mf.size) {
+        fprintf(stderr, "%s: truncated or corrupt labels file\n", path);
+        error(BAD_INPUT);
+    }
+    lf->n = hdr->n;
+    lf->k = hdr->k;
+    lf->id = (node_t *)(lf->mf.data + hdr->offset[LABELS_ID]);
+    lf->label = (uint32_t *)(lf->mf.data + hdr->offset[LABELS_LABEL]);
+}
+
+void
+unmapLabelsFile(LabelsFile *lf)
+{   // release a mapping created by `mapLabelsFile`
+    unmapFile(&lf->mf);
+    lf->id = NULL;
+    lf->label = NULL;
+}